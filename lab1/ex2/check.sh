@@ -2,13 +2,25 @@
 
 make clean
 make
-./ex2 < sample.in | diff sample.out -
-./ex2 < small_test.in | diff small_test.out -
-./ex2 < big_test.in | diff big_test.out -
+make treap
+make persistent
+for binary in ./ex2 ./ex2_treap ./ex2_persistent "./ex2 --bytecode" "./ex2_treap --bytecode" "./ex2_persistent --bytecode"
+do
+    $binary < sample.in | diff sample.out -
+    $binary < small_test.in | diff small_test.out -
+    $binary < big_test.in | diff big_test.out -
+    $binary < snapshot_test.in | diff snapshot_test.out -
+    $binary < range_test.in | diff range_test.out -
+    $binary < fork_test.in | diff fork_test.out -
+    $binary --compact-every 5 < range_test.in | diff range_test.out -
+    rm -f *.snapshot
+done
 
 if command -v valgrind
 then
     valgrind ./ex2 < sample.in
     valgrind ./ex2 < small_test.in
     valgrind ./ex2 < big_test.in
+    valgrind ./ex2_treap < big_test.in
+    valgrind ./ex2 --bytecode < big_test.in
 fi
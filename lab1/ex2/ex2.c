@@ -7,56 +7,112 @@
 // General purpose standard C lib
 #include <stdio.h>  // stdio includes printf
 #include <stdlib.h> // stdlib includes malloc() and free()
+#include <string.h> // string includes strcmp()
+#include <unistd.h> // unistd includes STDIN_FILENO
+#include <fcntl.h>  // fcntl includes open()
 
 // User-defined header files
-#include "node.h"
+#include "bytecode.h"
+#include "output_writer.h"
+#include "runner.h"
+#include "snapshot.h"
 
-// Macros
-#define PRINT_LIST 0
-#define INSERT_AT 1
-#define DELETE_AT 2
-#define ROTATE_LIST 3
-#define REVERSE_LIST 4
-#define RESET_LIST 5
+#define BYTECODE_FLAG "--bytecode"
+#define COMPACT_EVERY_FLAG "--compact-every"
 
-void run_instruction(list *lst, int instr);
-void print_list(list *lst);
+void print_values(const int *values, int num_values, void *context);
+int *read_values(instruction_reader *reader, int num_values);
 
-int main()
+// everything printed to stdout goes through this buffer
+static output_writer stdout_writer;
+// versions kept by FORK_LIST
+static list *forked_lists[MAX_FORKS];
+
+int main(int argc, char **argv)
 {
+    // compile the whole input before running it
+    int is_bytecode_mode = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], BYTECODE_FLAG) == 0)
+        {
+            is_bytecode_mode = 1;
+        }
+        else if (strcmp(argv[i], COMPACT_EVERY_FLAG) == 0 && i + 1 < argc)
+        {
+            // compacts the list after this many inserts or deletes
+            set_compact_interval(atoi(argv[++i]));
+        }
+        else
+        {
+            fprintf(stderr, "Error: unknown argument %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    instruction_reader reader;
+    if (open_reader(&reader, STDIN_FILENO) != 0 || open_writer(&stdout_writer, STDOUT_FILENO) != 0)
+    {
+        exit(1);
+    }
+
     list *lst = (list *)malloc(sizeof(list));
-    lst->head = NULL;
+    init_list(lst);
 
-    int instr;
-    while (scanf("%d", &instr) == 1)
+    if (is_bytecode_mode)
+    {
+        bytecode_program program;
+        compile_program(&reader, &program);
+        run_program(lst, &program);
+        free_program(&program);
+    }
+    else
     {
-        run_instruction(lst, instr);
+        int instr;
+        while (read_int(&reader, &instr))
+        {
+            run_instruction(lst, instr, &reader);
+        }
     }
 
+    close_reader(&reader);
+    close_writer(&stdout_writer);
     reset_list(lst);
     free(lst);
+
+    for (int i = 0; i < MAX_FORKS; i++)
+    {
+        if (forked_lists[i])
+        {
+            reset_list(forked_lists[i]);
+            free(forked_lists[i]);
+        }
+    }
 }
 
 // Takes an instruction enum and runs the corresponding function
 // We assume input always has the right format (no input validation on runner)
-void run_instruction(list *lst, int instr)
+void run_instruction(list *lst, int instr, instruction_reader *reader)
 {
-    int index, data, offset;
+    int index, data, offset, id, count;
+    int *values;
     switch (instr)
     {
     case PRINT_LIST:
         print_list(lst);
         break;
     case INSERT_AT:
-        scanf("%d %d", &index, &data);
+        read_int(reader, &index);
+        read_int(reader, &data);
         insert_node_at(lst, index, data);
         break;
     case DELETE_AT:
-        scanf("%d", &index);
+        read_int(reader, &index);
         delete_node_at(lst, index);
         break;
     case ROTATE_LIST:
-        scanf("%d", &offset);
+        read_int(reader, &offset);
         rotate_list(lst, offset);
         break;
     case REVERSE_LIST:
@@ -64,24 +120,171 @@ void run_instruction(list *lst, int instr)
         break;
     case RESET_LIST:
         reset_list(lst);
+        break;
+    case SAVE_LIST:
+        read_int(reader, &id);
+        save_snapshot(lst, id);
+        break;
+    case LOAD_LIST:
+        read_int(reader, &id);
+        load_snapshot(lst, id);
+        break;
+    case INSERT_RANGE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        values = read_values(reader, count);
+        insert_range_at(lst, index, values, count);
+        free(values);
+        break;
+    case DELETE_RANGE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        delete_range(lst, index, count);
+        break;
+    case SPLICE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        values = read_values(reader, count);
+        splice_values(lst, index, values, count);
+        free(values);
+        break;
+    case FORK_LIST:
+        read_int(reader, &id);
+        fork_to_slot(lst, id);
+        break;
+    case RESTORE_LIST:
+        read_int(reader, &id);
+        restore_from_slot(lst, id);
+        break;
+    case COMPACT_LIST:
+        compact_and_report(lst);
     }
 }
 
+// Reads the operand values of a range instruction into a new array
+int *read_values(instruction_reader *reader, int num_values)
+{
+    int *values = (int *)malloc((num_values > 0 ? num_values : 1) * sizeof(int));
+    for (int i = 0; i < num_values; i++)
+    {
+        read_int(reader, &values[i]);
+    }
+    return values;
+}
+
+// Builds the values into a list of their own and splices it in at index
+void splice_values(list *lst, int index, const int *values, int num_values)
+{
+    list other;
+    init_list(&other);
+    insert_range_at(&other, 0, values, num_values);
+    splice_list(lst, &other, index);
+    reset_list(&other);
+}
+
+// Keeps a fork of the list in slot id, replacing the one there
+void fork_to_slot(list *lst, int id)
+{
+    if (id < 0 || id >= MAX_FORKS)
+    {
+        fprintf(stderr, "Error: invalid fork slot %d\n", id);
+        return;
+    }
+
+    if (forked_lists[id])
+    {
+        reset_list(forked_lists[id]);
+        free(forked_lists[id]);
+    }
+    forked_lists[id] = list_fork(lst);
+}
+
+// Replaces the list with a fork of slot id, so that the slot can be
+// restored again later
+void restore_from_slot(list *lst, int id)
+{
+    if (id < 0 || id >= MAX_FORKS || !forked_lists[id])
+    {
+        fprintf(stderr, "Error: invalid fork slot %d\n", id);
+        return;
+    }
+
+    list *restored_lst = list_fork(forked_lists[id]);
+    reset_list(lst);
+    *lst = *restored_lst;
+    free(restored_lst);
+}
+
+// Reports on stderr so that the printed lists are unchanged
+void compact_and_report(list *lst)
+{
+    double locality_before = get_hop_locality(lst);
+    list_compact(lst);
+    fprintf(stderr, "Compacted list: hop locality %.1f%% -> %.1f%%\n", locality_before, get_hop_locality(lst));
+}
+
 // Prints out the whole list in a single line
 void print_list(list *lst)
 {
-    if (lst->head == NULL)
+    write_string(&stdout_writer, "[ ", 2);
+    traverse_list(lst, print_values, &stdout_writer);
+    write_string(&stdout_writer, "]\n", 2);
+}
+
+void print_values(const int *values, int num_values, void *context)
+{
+    output_writer *writer = (output_writer *)context;
+    for (int i = 0; i < num_values; i++)
+    {
+        write_long(writer, values[i], ' ');
+    }
+}
+
+// Writes the list to the snapshot file of id, replacing any older one
+void save_snapshot(list *lst, int id)
+{
+    char file_name[64];
+    snprintf(file_name, sizeof(file_name), SNAPSHOT_FILE_FORMAT, id);
+
+    int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: cannot open snapshot %s\n", file_name);
+        return;
+    }
+
+    if (list_save(lst, fd) != 0)
+    {
+        fprintf(stderr, "Error: cannot save snapshot %s\n", file_name);
+    }
+    close(fd);
+}
+
+// Replaces the list with the one in the snapshot file of id, the list is
+// left untouched if the snapshot cannot be loaded
+void load_snapshot(list *lst, int id)
+{
+    char file_name[64];
+    snprintf(file_name, sizeof(file_name), SNAPSHOT_FILE_FORMAT, id);
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd == -1)
     {
-        printf("[ ]\n");
+        fprintf(stderr, "Error: cannot open snapshot %s\n", file_name);
         return;
     }
 
-    printf("[ ");
-    node *curr = lst->head;
-    do
+    list *loaded_lst = list_load(fd);
+    close(fd);
+
+    if (!loaded_lst)
     {
-        printf("%d ", curr->data);
-        curr = curr->next;
-    } while (curr != lst->head);
-    printf("]\n");
+        fprintf(stderr, "Error: cannot load snapshot %s\n", file_name);
+        return;
+    }
+
+    // nodes live in the pool slabs, so the list can be moved by value
+    reset_list(lst);
+    *lst = *loaded_lst;
+    free(loaded_lst);
 }
@@ -0,0 +1,172 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "instruction_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Reads the next block of a non-mappable input, keeping any bytes that
+// were not decoded yet (a number cut off by the previous block)
+static void read_block(instruction_reader *reader)
+{
+    size_t num_leftover = reader->end - reader->position;
+    memmove(reader->data, reader->position, num_leftover);
+
+    ssize_t num_read;
+    do
+    {
+        num_read = read(reader->fd, reader->data + num_leftover, READ_BLOCK_SIZE - num_leftover);
+    } while (num_read > 0 && (num_leftover += num_read) < READ_BLOCK_SIZE);
+
+    if (num_read <= 0)
+    {
+        if (num_read < 0)
+        {
+            perror("read_block: read error");
+        }
+        reader->is_eof = 1;
+    }
+
+    reader->position = reader->data;
+    reader->end = reader->data + num_leftover;
+}
+
+// Decodes as many integers as fit into values from the undecoded bytes
+static void decode_batch(instruction_reader *reader)
+{
+    const char *position = reader->position;
+    const char *end = reader->end;
+    const char *limit = end;
+
+    // a number touching the end of a block may continue in the next one
+    if (!reader->is_eof)
+    {
+        while (limit > position && (is_digit(limit[-1]) || limit[-1] == '-'))
+        {
+            limit--;
+        }
+    }
+
+    int num_values = 0;
+    while (num_values < DECODE_BATCH_SIZE)
+    {
+        while (position < limit && !is_digit(*position) && *position != '-')
+        {
+            position++;
+        }
+
+        if (position == limit)
+        {
+            break;
+        }
+
+        int is_negative = *position == '-';
+        position += is_negative;
+
+        long value = 0;
+        while (position < limit && is_digit(*position))
+        {
+            value = value * 10 + (*position - '0');
+            position++;
+        }
+
+        reader->values[num_values++] = (int)(is_negative ? -value : value);
+    }
+
+    reader->position = position;
+    reader->num_values = num_values;
+    reader->next_value = 0;
+}
+
+int open_reader(instruction_reader *reader, int fd)
+{
+    struct stat file_stat;
+
+    reader->fd = fd;
+    reader->is_mapped = 0;
+    reader->is_eof = 0;
+    reader->num_values = 0;
+    reader->next_value = 0;
+
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0)
+    {
+        reader->data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (reader->data != MAP_FAILED)
+        {
+            madvise(reader->data, file_stat.st_size, MADV_SEQUENTIAL);
+            reader->is_mapped = 1;
+            reader->is_eof = 1;
+            reader->data_size = file_stat.st_size;
+            reader->position = reader->data;
+            reader->end = reader->data + reader->data_size;
+            return 0;
+        }
+    }
+
+    // fall back to reading blocks
+    reader->data_size = READ_BLOCK_SIZE;
+    reader->data = (char *)malloc(reader->data_size);
+    if (!reader->data)
+    {
+        perror("open_reader: malloc error");
+        return -1;
+    }
+
+    reader->position = reader->data;
+    reader->end = reader->data;
+    return 0;
+}
+
+int read_int(instruction_reader *reader, int *value)
+{
+    while (reader->next_value == reader->num_values)
+    {
+        if (reader->position == reader->end && reader->is_eof)
+        {
+            return 0;
+        }
+
+        decode_batch(reader);
+
+        if (reader->num_values == 0)
+        {
+            if (reader->is_eof)
+            {
+                reader->position = reader->end;
+                return 0;
+            }
+            read_block(reader);
+        }
+    }
+
+    *value = reader->values[reader->next_value++];
+    return 1;
+}
+
+void close_reader(instruction_reader *reader)
+{
+    if (reader->is_mapped)
+    {
+        munmap(reader->data, reader->data_size);
+    }
+    else
+    {
+        free(reader->data);
+    }
+}
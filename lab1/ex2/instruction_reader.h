@@ -0,0 +1,41 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef INSTRUCTION_READER_H
+#define INSTRUCTION_READER_H
+
+#include <stddef.h>
+
+#define READ_BLOCK_SIZE (1 << 20)
+#define DECODE_BATCH_SIZE 4096
+
+// Reads whitespace separated integers from a file descriptor. Regular
+// files are mapped into memory, anything else (e.g. a pipe on stdin) is
+// read in large blocks. Integers are decoded in batches into values and
+// handed out one at a time by read_int.
+typedef struct
+{
+    int fd;
+    int is_mapped;
+    int is_eof;
+    // bytes that have not been decoded yet are in [position, end)
+    char *data;
+    size_t data_size;
+    const char *position;
+    const char *end;
+    int values[DECODE_BATCH_SIZE];
+    int num_values;
+    int next_value;
+} instruction_reader;
+
+// returns 0 on success else -1
+int open_reader(instruction_reader *reader, int fd);
+// returns 1 and sets value if there is another integer else 0
+int read_int(instruction_reader *reader, int *value);
+void close_reader(instruction_reader *reader);
+
+#endif
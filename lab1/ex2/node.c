@@ -12,38 +12,74 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define TRAVERSE_BATCH_SIZE 256
+
+static int compact_interval = 0;
+
 // Add in your implementation below to the respective functions
 // Feel free to add any headers you deem fit (although you do not need to)
+void init_list(list *lst)
+{
+    lst->head = NULL;
+    lst->tail = NULL;
+    lst->length = 0;
+    lst->finger = NULL;
+    lst->finger_index = 0;
+    init_pool(&(lst->pool), sizeof(node));
+    lst->num_mutations = 0;
+}
+
 int get_list_length(list *lst)
 {
-    if (!lst->head)
-    {
-        return 0;
-    }
+    return lst->length;
+}
 
-    int length = 0;
-    node *current_node = lst->head;
+static void set_finger(list *lst, node *finger_node, int index)
+{
+    lst->finger = finger_node;
+    lst->finger_index = index;
+}
 
-    do
+// Counts an insert or delete, which may leave nodes scattered, and
+// compacts the list once compact_interval of them add up
+static void count_mutation(list *lst)
+{
+    if (compact_interval && ++lst->num_mutations >= compact_interval)
     {
-        length++;
-        current_node = current_node->next;
-    } while (current_node != lst->head);
-
-    return length;
+        list_compact(lst);
+    }
 }
 
+// Walks from whichever known position (head, tail or finger) is closest
+// before index, so sequential lookups are O(1) amortized.
 node *get_node_at(list *lst, int index)
 {
+    if (!lst->head)
+    {
+        return NULL;
+    }
+
+    if (index == lst->length - 1)
+    {
+        return lst->tail;
+    }
+
     int current_index = 0;
     node *current_node = lst->head;
 
-    while (current_node && current_index < index)
+    if (lst->finger && lst->finger_index <= index)
+    {
+        current_index = lst->finger_index;
+        current_node = lst->finger;
+    }
+
+    while (current_index < index)
     {
         current_index++;
         current_node = current_node->next;
     }
 
+    set_finger(lst, current_node, index);
     return current_node;
 }
 
@@ -52,70 +88,197 @@ node *get_node_at(list *lst, int index)
 // Note: index is guaranteed to be valid.
 void insert_node_at(list *lst, int index, int data)
 {
-    node *new_node = (node *)malloc(sizeof(node));
-    new_node->data = data;
+    insert_range_at(lst, index, &data, 1);
+}
 
-    // case 1: node is inserted at the head
-    // need to update head and tail pointer
-    if (index == 0)
+// Inserts num_values new nodes with the given data values, the first
+// one at index. The new nodes are linked into a chain first so that the
+// list is only walked once.
+// Note: index is guaranteed to be valid.
+void insert_range_at(list *lst, int index, const int *values, int num_values)
+{
+    if (num_values <= 0)
     {
-        int length = get_list_length(lst);
-        node *tail_node = get_node_at(lst, length - 1);
+        return;
+    }
 
-        // old head becomes new head -> next if old head exists
-        // else new head -> next = new head
-        new_node->next = lst->head ? lst->head : new_node;
-        lst->head = new_node;
+    node *first_node = (node *)allocate_from_pool(&(lst->pool));
+    node *last_node = first_node;
+    first_node->data = values[0];
+
+    for (int i = 1; i < num_values; i++)
+    {
+        last_node->next = (node *)allocate_from_pool(&(lst->pool));
+        last_node = last_node->next;
+        last_node->data = values[i];
+    }
 
-        // update tail_node -> next to new head
-        if (tail_node)
+    if (!lst->head)
+    {
+        last_node->next = first_node;
+        lst->head = first_node;
+        lst->tail = last_node;
+    }
+    else
+    {
+        // the node before the head is the tail
+        node *previous_node = index == 0 ? lst->tail : get_node_at(lst, index - 1);
+        last_node->next = previous_node->next;
+        previous_node->next = first_node;
+
+        if (index == 0)
         {
-            tail_node->next = lst->head;
+            lst->head = first_node;
+        }
+        if (index == lst->length)
+        {
+            lst->tail = last_node;
         }
-
-        return;
     }
 
-    // case 2: node is inserted elsewhere
-    node *previous_node = get_node_at(lst, index - 1);
-    new_node->next = previous_node->next;
-    previous_node->next = new_node;
+    lst->length += num_values;
+    set_finger(lst, last_node, index + num_values - 1);
+    count_mutation(lst);
 }
 
 // Deletes node at index (counting from head starting from 0).
 // Note: index is guarenteed to be valid.
 void delete_node_at(list *lst, int index)
 {
-    // case 1: node is removed from the head
-    if (index == 0)
+    // the node before the head is the tail
+    node *previous_node = index == 0 ? lst->tail : get_node_at(lst, index - 1);
+    node *to_remove_node = previous_node->next;
+
+    if (lst->length == 1)
     {
-        node *old_head = lst->head;
-        int length = get_list_length(lst);
+        lst->head = NULL;
+        lst->tail = NULL;
+        set_finger(lst, NULL, 0);
+    }
+    else
+    {
+        previous_node->next = to_remove_node->next;
+
+        if (to_remove_node == lst->head)
+        {
+            lst->head = to_remove_node->next;
+        }
+        if (to_remove_node == lst->tail)
+        {
+            lst->tail = previous_node;
+        }
 
-        if (length == 1)
+        if (index == 0)
         {
-            lst->head = NULL;
+            set_finger(lst, lst->head, 0);
         }
         else
         {
-            node *tail_node = get_node_at(lst, length - 1);
-            lst->head = old_head->next;
-            tail_node->next = lst->head;
+            set_finger(lst, previous_node, index - 1);
         }
+    }
+
+    lst->length--;
 
-        // clean up
-        free(old_head);
+    // clean up
+    free_to_pool(&(lst->pool), to_remove_node);
+    count_mutation(lst);
+}
 
+// Deletes the count nodes starting at index with a single walk to the
+// node before them.
+// Note: index and count are guaranteed to be valid.
+void delete_range(list *lst, int index, int count)
+{
+    if (count <= 0)
+    {
         return;
     }
 
-    // case 2: node is removed elsewhere
-    node *previous_node = get_node_at(lst, index - 1);
-    node *to_remove_node = previous_node->next;
-    previous_node->next = to_remove_node->next;
+    if (count == lst->length)
+    {
+        reset_list(lst);
+        return;
+    }
 
-    // clean up
-    free(to_remove_node);
+    // the node before the head is the tail
+    node *previous_node = index == 0 ? lst->tail : get_node_at(lst, index - 1);
+    node *current_node = previous_node->next;
+
+    for (int i = 0; i < count; i++)
+    {
+        node *next_node = current_node->next;
+        free_to_pool(&(lst->pool), current_node);
+        current_node = next_node;
+    }
+
+    previous_node->next = current_node;
+
+    if (index == 0)
+    {
+        lst->head = current_node;
+    }
+    if (index + count == lst->length)
+    {
+        lst->tail = previous_node;
+    }
+
+    lst->length -= count;
+
+    if (index == 0)
+    {
+        set_finger(lst, lst->head, 0);
+    }
+    else
+    {
+        set_finger(lst, previous_node, index - 1);
+    }
+
+    count_mutation(lst);
+}
+
+// Links the nodes of other in at index with a single walk, the nodes
+// themselves are not touched. The slabs of other move to lst with them.
+// Note: index is guaranteed to be valid.
+void splice_list(list *lst, list *other, int index)
+{
+    if (!other->head)
+    {
+        return;
+    }
+
+    if (!lst->head)
+    {
+        lst->head = other->head;
+        lst->tail = other->tail;
+    }
+    else
+    {
+        // the node before the head is the tail
+        node *previous_node = index == 0 ? lst->tail : get_node_at(lst, index - 1);
+        other->tail->next = previous_node->next;
+        previous_node->next = other->head;
+
+        if (index == 0)
+        {
+            lst->head = other->head;
+        }
+        if (index == lst->length)
+        {
+            lst->tail = other->tail;
+        }
+    }
+
+    lst->length += other->length;
+    set_finger(lst, other->tail, index + other->length - 1);
+    merge_pool(&(lst->pool), &(other->pool));
+
+    other->head = NULL;
+    other->tail = NULL;
+    other->length = 0;
+    set_finger(other, NULL, 0);
+
+    count_mutation(lst);
 }
 
 // Rotates list by the given offset.
@@ -124,20 +287,19 @@ void rotate_list(list *lst, int offset)
 {
     int length = get_list_length(lst);
 
-    if (length <= 1)
+    if (length <= 1 || offset % length == 0)
     {
         return;
     }
 
     offset = offset % length;
-    node *current_node = lst->head;
+    node *previous_node = get_node_at(lst, offset - 1);
 
-    while (offset--)
-    {
-        current_node = current_node->next;
-    }
+    lst->head = previous_node->next;
+    lst->tail = previous_node;
 
-    lst->head = current_node;
+    // every node moves offset positions towards the head
+    lst->finger_index = (lst->finger_index - offset + length) % length;
 }
 
 // Reverses the list, with the original "tail" node
@@ -165,7 +327,9 @@ void reverse_list(list *lst)
 
     // link last node (original head) -> next to new head
     lst->head->next = previous_node;
+    lst->tail = lst->head;
     lst->head = previous_node;
+    lst->finger_index = lst->length - 1 - lst->finger_index;
 }
 
 // Resets list to an empty state (no nodes) and frees
@@ -181,19 +345,166 @@ void reset_list(list *lst)
     // return;
 
     // approach 2 O(n): single pass
+    // node *current_node = lst->head->next;
+    // while (current_node != lst->head)
+    // {
+    //     node *next_node = current_node->next;
+    //     free(current_node);
+    //     current_node = next_node;
+    // }
+    // free(lst->head);
+
+    // approach 3 O(n / OBJECTS_PER_SLAB): nodes are never freed one at a
+    // time, the whole pool is dropped instead
+    destroy_pool(&(lst->pool));
+    lst->head = NULL;
+    lst->tail = NULL;
+    lst->length = 0;
+    set_finger(lst, NULL, 0);
+}
+
+// Copies every node into a new list with a single walk.
+list *list_fork(list *lst)
+{
+    list *new_lst = (list *)malloc(sizeof(list));
+    init_list(new_lst);
+
+    if (!lst->head)
+    {
+        return new_lst;
+    }
+
+    node *current_node = lst->head;
+    node *last_node = NULL;
+
+    do
+    {
+        node *new_node = (node *)allocate_from_pool(&(new_lst->pool));
+        new_node->data = current_node->data;
+
+        if (last_node)
+        {
+            last_node->next = new_node;
+        }
+        else
+        {
+            new_lst->head = new_node;
+        }
+
+        last_node = new_node;
+        current_node = current_node->next;
+    } while (current_node != lst->head);
+
+    last_node->next = new_lst->head;
+    new_lst->tail = last_node;
+    new_lst->length = lst->length;
+    return new_lst;
+}
+
+// Copies every node into fresh slabs in list order and relinks them, so
+// that every hop apart from one per slab lands on the adjacent slot.
+void list_compact(list *lst)
+{
+    lst->num_mutations = 0;
+
     if (!lst->head)
     {
         return;
     }
 
-    node *current_node = lst->head->next;
-    while (current_node != lst->head)
+    node_pool new_pool;
+    init_pool(&new_pool, sizeof(node));
+
+    node *current_node = lst->head;
+    node *new_head = NULL;
+    node *new_finger = NULL;
+    node *last_node = NULL;
+
+    do
     {
-        node *next_node = current_node->next;
-        free(current_node);
-        current_node = next_node;
+        node *new_node = (node *)allocate_from_pool(&new_pool);
+        new_node->data = current_node->data;
+
+        if (last_node)
+        {
+            last_node->next = new_node;
+        }
+        else
+        {
+            new_head = new_node;
+        }
+        if (current_node == lst->finger)
+        {
+            new_finger = new_node;
+        }
+
+        last_node = new_node;
+        current_node = current_node->next;
+    } while (current_node != lst->head);
+
+    last_node->next = new_head;
+
+    destroy_pool(&(lst->pool));
+    lst->pool = new_pool;
+    lst->head = new_head;
+    lst->tail = last_node;
+    lst->finger = new_finger;
+}
+
+void set_compact_interval(int interval)
+{
+    compact_interval = interval > 0 ? interval : 0;
+}
+
+double get_hop_locality(list *lst)
+{
+    if (lst->length <= 1)
+    {
+        return 100;
     }
 
-    free(lst->head);
-    lst->head = NULL;
+    int num_adjacent = 0;
+    node *current_node = lst->head;
+
+    while (current_node != lst->tail)
+    {
+        if (current_node->next == current_node + 1)
+        {
+            num_adjacent++;
+        }
+        current_node = current_node->next;
+    }
+
+    return 100.0 * num_adjacent / (lst->length - 1);
+}
+
+// Copies data values into a fixed size buffer and hands them to visit
+// one batch at a time, from head to tail.
+void traverse_list(list *lst, void (*visit)(const int *values, int num_values, void *context), void *context)
+{
+    if (!lst->head)
+    {
+        return;
+    }
+
+    int values[TRAVERSE_BATCH_SIZE];
+    int num_values = 0;
+    node *current_node = lst->head;
+
+    do
+    {
+        values[num_values++] = current_node->data;
+        current_node = current_node->next;
+
+        if (num_values == TRAVERSE_BATCH_SIZE)
+        {
+            visit(values, num_values, context);
+            num_values = 0;
+        }
+    } while (current_node != lst->head);
+
+    if (num_values)
+    {
+        visit(values, num_values, context);
+    }
 }
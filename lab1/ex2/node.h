@@ -4,6 +4,56 @@
     during grading so any changes in this file will be overwritten
 */
 
+#ifndef NODE_H
+#define NODE_H
+
+#include "node_pool.h"
+
+#if defined(PERSISTENT_LIST)
+// Persistent implicit treap: nodes are shared between list versions and
+// copied on write. A node with refcount above 1 is reachable from more
+// than one version and is never modified in place.
+typedef struct NODE
+{
+    int data;
+    int size;
+    unsigned int priority;
+    // 1 if the children of this subtree still have to be swapped
+    int is_reversed;
+    int refcount;
+    struct NODE *left;
+    struct NODE *right;
+} node;
+
+// Nodes come from a pool shared by every version, so a list holds no
+// allocator of its own
+typedef struct
+{
+    node *root;
+} list;
+#elif defined(TREAP_LIST)
+// Implicit treap: nodes are ordered by position (in-order traversal
+// gives head to tail) instead of by key. Every node caches the size of
+// its subtree so that index based operations take O(log n).
+typedef struct NODE
+{
+    int data;
+    int size;
+    unsigned int priority;
+    // 1 if the children of this subtree still have to be swapped
+    int is_reversed;
+    struct NODE *left;
+    struct NODE *right;
+} node;
+
+typedef struct
+{
+    node *root;
+    node_pool pool;
+    // mutations since the last list_compact
+    int num_mutations;
+} list;
+#else
 typedef struct NODE
 {
     int data;
@@ -13,10 +63,44 @@ typedef struct NODE
 typedef struct
 {
     node *head;
+    node *tail;
+    int length;
+    // last node looked up or modified and its index, lookups at or after
+    // finger_index walk from it instead of from the head
+    node *finger;
+    int finger_index;
+    node_pool pool;
+    // mutations since the last list_compact
+    int num_mutations;
 } list;
+#endif
 
+void init_list(list *lst);
 void insert_node_at(list *lst, int index, int data);
+void insert_range_at(list *lst, int index, const int *values, int num_values);
 void delete_node_at(list *lst, int index);
+// Deletes the count nodes starting at index
+void delete_range(list *lst, int index, int count);
+// Moves every node of other into lst, the first one at index, and leaves
+// other empty
+void splice_list(list *lst, list *other, int index);
 void rotate_list(list *lst, int offset);
 void reverse_list(list *lst);
 void reset_list(list *lst);
+int get_list_length(list *lst);
+// Calls visit on consecutive batches of data values from head to tail
+void traverse_list(list *lst, void (*visit)(const int *values, int num_values, void *context), void *context);
+// Returns a new list with the same values as lst, in O(1) for the
+// persistent list and O(n) otherwise
+list *list_fork(list *lst);
+// Moves the nodes into fresh memory in list order. The persistent list
+// shares its nodes between versions and is left as it is.
+void list_compact(list *lst);
+// Compacts every list after this many inserts or deletes, 0 (the default)
+// turns this off
+void set_compact_interval(int interval);
+// Percentage of hops from a node to the next one in list order that land
+// on the adjacent slot in memory
+double get_hop_locality(list *lst);
+
+#endif
@@ -0,0 +1,441 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Persistent implicit treap implementation of the circular list (compile
+// with -DPERSISTENT_LIST). It works like node_treap.c, except that nodes
+// are reference counted and shared between the versions made by
+// list_fork. Before a node is modified it is made unique: a shared node
+// is copied and the copy takes over the reference. An operation therefore
+// only copies the O(log n) nodes on the paths it walks.
+//
+// Ownership: a list owns one reference to its root and every node owns
+// one reference to each of its children. split and merge consume the
+// references they are given and return the ones they produce.
+
+#include "node.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRAVERSE_BATCH_SIZE 256
+
+typedef struct
+{
+    int values[TRAVERSE_BATCH_SIZE];
+    int num_values;
+    void (*visit)(const int *values, int num_values, void *context);
+    void *context;
+} traverse_context;
+
+// Tracks the previous node of an in-order walk for get_hop_locality
+typedef struct
+{
+    node *previous;
+    int num_adjacent;
+} locality_context;
+
+static unsigned int random_state = 2106;
+
+// shared by every version since nodes outlive the list that made them
+static node_pool pool;
+static int is_pool_ready = 0;
+
+// xorshift32, good enough for treap priorities
+static unsigned int next_priority()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static int get_size(node *current_node)
+{
+    return current_node ? current_node->size : 0;
+}
+
+static void update_size(node *current_node)
+{
+    current_node->size = 1 + get_size(current_node->left) + get_size(current_node->right);
+}
+
+static node *retain(node *current_node)
+{
+    if (current_node)
+    {
+        current_node->refcount++;
+    }
+    return current_node;
+}
+
+// Drops a reference, freeing the subtree that is no longer reachable
+static void release(node *current_node)
+{
+    if (!current_node || --current_node->refcount > 0)
+    {
+        return;
+    }
+
+    release(current_node->left);
+    release(current_node->right);
+    free_to_pool(&pool, current_node);
+}
+
+// Returns a node that can be modified in place in exchange for the given
+// reference, which is a copy if the node is shared
+static node *make_unique(node *current_node)
+{
+    if (current_node->refcount == 1)
+    {
+        return current_node;
+    }
+
+    node *new_node = (node *)allocate_from_pool(&pool);
+    *new_node = *current_node;
+    new_node->refcount = 1;
+    retain(new_node->left);
+    retain(new_node->right);
+
+    current_node->refcount--;
+    return new_node;
+}
+
+// Pushes a pending reversal one level down. current_node must be unique,
+// its children are made unique before their flags change.
+static void push_down(node *current_node)
+{
+    if (!current_node->is_reversed)
+    {
+        return;
+    }
+
+    node *temp_node = current_node->left;
+    current_node->left = current_node->right;
+    current_node->right = temp_node;
+
+    if (current_node->left)
+    {
+        current_node->left = make_unique(current_node->left);
+        current_node->left->is_reversed ^= 1;
+    }
+    if (current_node->right)
+    {
+        current_node->right = make_unique(current_node->right);
+        current_node->right->is_reversed ^= 1;
+    }
+
+    current_node->is_reversed = 0;
+}
+
+// Splits tree into the first count nodes (left) and the rest (right)
+static void split(node *current_node, int count, node **left, node **right)
+{
+    if (!current_node)
+    {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    current_node = make_unique(current_node);
+    push_down(current_node);
+
+    if (get_size(current_node->left) < count)
+    {
+        split(current_node->right, count - get_size(current_node->left) - 1, &(current_node->right), right);
+        *left = current_node;
+    }
+    else
+    {
+        split(current_node->left, count, left, &(current_node->left));
+        *right = current_node;
+    }
+
+    update_size(current_node);
+}
+
+// Concatenates two trees, all nodes of left come before those of right
+static node *merge(node *left, node *right)
+{
+    if (!left || !right)
+    {
+        return left ? left : right;
+    }
+
+    if (left->priority > right->priority)
+    {
+        left = make_unique(left);
+        push_down(left);
+        left->right = merge(left->right, right);
+        update_size(left);
+        return left;
+    }
+
+    right = make_unique(right);
+    push_down(right);
+    right->left = merge(left, right->left);
+    update_size(right);
+    return right;
+}
+
+static node *create_node(int data)
+{
+    node *new_node = (node *)allocate_from_pool(&pool);
+    new_node->data = data;
+    new_node->size = 1;
+    new_node->priority = next_priority();
+    new_node->is_reversed = 0;
+    new_node->refcount = 1;
+    new_node->left = NULL;
+    new_node->right = NULL;
+    return new_node;
+}
+
+// Builds a treap holding values in order in O(n). The right spine is kept
+// on a stack, a node is final (and its size known) once it is popped.
+static node *build_tree(const int *values, int num_values)
+{
+    node **spine = (node **)malloc(num_values * sizeof(node *));
+    int spine_size = 0;
+
+    for (int i = 0; i < num_values; i++)
+    {
+        node *new_node = create_node(values[i]);
+        node *last_popped = NULL;
+
+        while (spine_size && spine[spine_size - 1]->priority < new_node->priority)
+        {
+            last_popped = spine[--spine_size];
+            update_size(last_popped);
+        }
+
+        new_node->left = last_popped;
+        if (spine_size)
+        {
+            spine[spine_size - 1]->right = new_node;
+        }
+        spine[spine_size++] = new_node;
+    }
+
+    while (spine_size > 1)
+    {
+        update_size(spine[--spine_size]);
+    }
+    update_size(spine[0]);
+
+    node *root = spine[0];
+    free(spine);
+    return root;
+}
+
+// Visits the subtree in order without modifying it, since it may be
+// shared. is_reversed carries the pending reversals of the ancestors.
+static void traverse_tree(node *current_node, int is_reversed, traverse_context *traverse_ctx)
+{
+    if (!current_node)
+    {
+        return;
+    }
+
+    is_reversed ^= current_node->is_reversed;
+    traverse_tree(is_reversed ? current_node->right : current_node->left, is_reversed, traverse_ctx);
+
+    traverse_ctx->values[traverse_ctx->num_values++] = current_node->data;
+    if (traverse_ctx->num_values == TRAVERSE_BATCH_SIZE)
+    {
+        traverse_ctx->visit(traverse_ctx->values, traverse_ctx->num_values, traverse_ctx->context);
+        traverse_ctx->num_values = 0;
+    }
+
+    traverse_tree(is_reversed ? current_node->left : current_node->right, is_reversed, traverse_ctx);
+}
+
+// Like traverse_tree, reads pending reversals without pushing them down
+static void count_adjacent(node *current_node, int is_reversed, locality_context *locality_ctx)
+{
+    if (!current_node)
+    {
+        return;
+    }
+
+    is_reversed ^= current_node->is_reversed;
+    count_adjacent(is_reversed ? current_node->right : current_node->left, is_reversed, locality_ctx);
+
+    if (locality_ctx->previous && locality_ctx->previous + 1 == current_node)
+    {
+        locality_ctx->num_adjacent++;
+    }
+    locality_ctx->previous = current_node;
+
+    count_adjacent(is_reversed ? current_node->left : current_node->right, is_reversed, locality_ctx);
+}
+
+void init_list(list *lst)
+{
+    if (!is_pool_ready)
+    {
+        init_pool(&pool, sizeof(node));
+        is_pool_ready = 1;
+    }
+
+    lst->root = NULL;
+}
+
+int get_list_length(list *lst)
+{
+    return get_size(lst->root);
+}
+
+// Inserts a new node with data value at index (counting from head
+// starting at 0).
+// Note: index is guaranteed to be valid.
+void insert_node_at(list *lst, int index, int data)
+{
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, create_node(data)), right);
+}
+
+// Inserts num_values new nodes with the given data values, the first
+// one at index, by merging in a treap built from values in O(n).
+// Note: index is guaranteed to be valid.
+void insert_range_at(list *lst, int index, const int *values, int num_values)
+{
+    if (num_values <= 0)
+    {
+        return;
+    }
+
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, build_tree(values, num_values)), right);
+}
+
+// Deletes node at index (counting from head starting from 0).
+// Note: index is guarenteed to be valid.
+void delete_node_at(list *lst, int index)
+{
+    delete_range(lst, index, 1);
+}
+
+// Deletes the count nodes starting at index by splitting them off as
+// one subtree. Nodes still used by other versions are kept.
+// Note: index and count are guaranteed to be valid.
+void delete_range(list *lst, int index, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    node *left, *middle, *right;
+    split(lst->root, index, &left, &right);
+    split(right, count, &middle, &right);
+    lst->root = merge(left, right);
+
+    // clean up
+    release(middle);
+}
+
+// Merges the tree of other in at index in O(log n), taking over the
+// reference of other to it.
+// Note: index is guaranteed to be valid.
+void splice_list(list *lst, list *other, int index)
+{
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, other->root), right);
+
+    other->root = NULL;
+}
+
+// Rotates list by the given offset.
+// Note: offset is guarenteed to be non-negative.
+void rotate_list(list *lst, int offset)
+{
+    int length = get_list_length(lst);
+
+    if (length <= 1 || offset % length == 0)
+    {
+        return;
+    }
+
+    node *left, *right;
+    split(lst->root, offset % length, &left, &right);
+    lst->root = merge(right, left);
+}
+
+// Reverses the list, with the original "tail" node
+// becoming the new head node.
+void reverse_list(list *lst)
+{
+    if (lst->root)
+    {
+        lst->root = make_unique(lst->root);
+        lst->root->is_reversed ^= 1;
+    }
+}
+
+// Resets list to an empty state (no nodes) and frees the nodes that no
+// other version uses
+void reset_list(list *lst)
+{
+    release(lst->root);
+    lst->root = NULL;
+}
+
+// Visits data values from head to tail in batches.
+void traverse_list(list *lst, void (*visit)(const int *values, int num_values, void *context), void *context)
+{
+    traverse_context traverse_ctx;
+    traverse_ctx.num_values = 0;
+    traverse_ctx.visit = visit;
+    traverse_ctx.context = context;
+
+    traverse_tree(lst->root, 0, &traverse_ctx);
+
+    if (traverse_ctx.num_values)
+    {
+        visit(traverse_ctx.values, traverse_ctx.num_values, context);
+    }
+}
+
+// Returns a new version sharing every node with lst in O(1).
+list *list_fork(list *lst)
+{
+    list *new_lst = (list *)malloc(sizeof(list));
+    init_list(new_lst);
+    new_lst->root = retain(lst->root);
+    return new_lst;
+}
+
+// Nodes may be shared with other versions, so they are never moved.
+void list_compact(list *lst)
+{
+    (void)lst;
+}
+
+void set_compact_interval(int interval)
+{
+    (void)interval;
+}
+
+double get_hop_locality(list *lst)
+{
+    int length = get_list_length(lst);
+    if (length <= 1)
+    {
+        return 100;
+    }
+
+    locality_context locality_ctx;
+    locality_ctx.previous = NULL;
+    locality_ctx.num_adjacent = 0;
+    count_adjacent(lst->root, 0, &locality_ctx);
+
+    return 100.0 * locality_ctx.num_adjacent / (length - 1);
+}
@@ -0,0 +1,120 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "node_pool.h"
+
+#include <stdlib.h>
+
+void init_pool(node_pool *pool, size_t object_size)
+{
+    // every object must be able to hold the free list pointer
+    pool->object_size = object_size < sizeof(void *) ? sizeof(void *) : object_size;
+    pool->fresh_slabs = NULL;
+    pool->used_slabs = NULL;
+    pool->free_objects = NULL;
+    pool->last_free_object = NULL;
+}
+
+void *allocate_from_pool(node_pool *pool)
+{
+    if (pool->free_objects)
+    {
+        void *object = pool->free_objects;
+        pool->free_objects = *(void **)object;
+        if (!pool->free_objects)
+        {
+            pool->last_free_object = NULL;
+        }
+        return object;
+    }
+
+    if (!pool->fresh_slabs)
+    {
+        slab *new_slab = (slab *)malloc(sizeof(slab) + OBJECTS_PER_SLAB * pool->object_size);
+        new_slab->next = NULL;
+        new_slab->num_fresh_objects = OBJECTS_PER_SLAB;
+        pool->fresh_slabs = new_slab;
+    }
+
+    slab *current_slab = pool->fresh_slabs;
+    char *objects = (char *)(current_slab + 1);
+    void *object = objects + (OBJECTS_PER_SLAB - current_slab->num_fresh_objects--) * pool->object_size;
+
+    if (current_slab->num_fresh_objects == 0)
+    {
+        pool->fresh_slabs = current_slab->next;
+        current_slab->next = pool->used_slabs;
+        pool->used_slabs = current_slab;
+    }
+    return object;
+}
+
+void free_to_pool(node_pool *pool, void *object)
+{
+    if (!pool->free_objects)
+    {
+        pool->last_free_object = object;
+    }
+    *(void **)object = pool->free_objects;
+    pool->free_objects = object;
+}
+
+static void free_slabs(slab *current_slab)
+{
+    while (current_slab)
+    {
+        slab *next_slab = current_slab->next;
+        free(current_slab);
+        current_slab = next_slab;
+    }
+}
+
+// Releases every slab at once, objects do not have to be freed first
+void destroy_pool(node_pool *pool)
+{
+    free_slabs(pool->fresh_slabs);
+    free_slabs(pool->used_slabs);
+
+    init_pool(pool, pool->object_size);
+}
+
+// Links the slabs of src in front of those of dst and returns the result
+static slab *prepend_slabs(slab *dst, slab *src)
+{
+    if (!src)
+    {
+        return dst;
+    }
+
+    slab *last_slab = src;
+    while (last_slab->next)
+    {
+        last_slab = last_slab->next;
+    }
+    last_slab->next = dst;
+    return src;
+}
+
+void merge_pool(node_pool *dst, node_pool *src)
+{
+    // the fresh objects of src stay in their slabs, which dst allocates
+    // from before its own
+    dst->fresh_slabs = prepend_slabs(dst->fresh_slabs, src->fresh_slabs);
+    dst->used_slabs = prepend_slabs(dst->used_slabs, src->used_slabs);
+
+    if (src->free_objects)
+    {
+        *(void **)src->last_free_object = dst->free_objects;
+        if (!dst->free_objects)
+        {
+            dst->last_free_object = src->last_free_object;
+        }
+        dst->free_objects = src->free_objects;
+    }
+
+    init_pool(src, src->object_size);
+}
@@ -0,0 +1,47 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stddef.h>
+
+#define OBJECTS_PER_SLAB 1024
+
+// Header of a slab, followed by OBJECTS_PER_SLAB objects
+typedef struct SLAB
+{
+    struct SLAB *next;
+    // objects at the end of the slab that were never handed out
+    int num_fresh_objects;
+} slab;
+
+// Slab allocator for fixed size objects. Freed objects are kept on a free
+// list threaded through their first word and reused before any new slab
+// is allocated. All slabs are released together by destroy_pool.
+typedef struct
+{
+    size_t object_size;
+    // slabs that still have fresh objects, the first one is allocated from
+    slab *fresh_slabs;
+    // slabs that have handed out all of their objects
+    slab *used_slabs;
+    void *free_objects;
+    // end of the free list, so that another one can be appended in O(1)
+    void *last_free_object;
+} node_pool;
+
+void init_pool(node_pool *pool, size_t object_size);
+void *allocate_from_pool(node_pool *pool);
+void free_to_pool(node_pool *pool, void *object);
+void destroy_pool(node_pool *pool);
+// Hands every slab of src over to dst and leaves src empty, so that
+// objects allocated from src can be freed to and released by dst. Takes
+// time in the number of slabs of src, not in its objects.
+void merge_pool(node_pool *dst, node_pool *src);
+
+#endif
@@ -0,0 +1,454 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Implicit treap implementation of the circular list (compile with
+// -DTREAP_LIST). Positions are implicit: the index of a node is the number
+// of nodes before it in an in-order traversal. Rotation is a split and a
+// merge, and reversal is a lazy flag on the root.
+
+#include "node.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRAVERSE_BATCH_SIZE 256
+
+typedef struct
+{
+    int values[TRAVERSE_BATCH_SIZE];
+    int num_values;
+    void (*visit)(const int *values, int num_values, void *context);
+    void *context;
+} traverse_context;
+
+// Tracks the previous node of an in-order walk for get_hop_locality
+typedef struct
+{
+    node *previous;
+    int num_adjacent;
+} locality_context;
+
+static unsigned int random_state = 2106;
+static int compact_interval = 0;
+
+// xorshift32, good enough for treap priorities
+static unsigned int next_priority()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static int get_size(node *current_node)
+{
+    return current_node ? current_node->size : 0;
+}
+
+static void update_size(node *current_node)
+{
+    current_node->size = 1 + get_size(current_node->left) + get_size(current_node->right);
+}
+
+// Pushes a pending reversal one level down
+static void push_down(node *current_node)
+{
+    if (!current_node->is_reversed)
+    {
+        return;
+    }
+
+    node *temp_node = current_node->left;
+    current_node->left = current_node->right;
+    current_node->right = temp_node;
+
+    if (current_node->left)
+    {
+        current_node->left->is_reversed ^= 1;
+    }
+    if (current_node->right)
+    {
+        current_node->right->is_reversed ^= 1;
+    }
+
+    current_node->is_reversed = 0;
+}
+
+// Splits tree into the first count nodes (left) and the rest (right)
+static void split(node *current_node, int count, node **left, node **right)
+{
+    if (!current_node)
+    {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    push_down(current_node);
+
+    if (get_size(current_node->left) < count)
+    {
+        split(current_node->right, count - get_size(current_node->left) - 1, &(current_node->right), right);
+        *left = current_node;
+    }
+    else
+    {
+        split(current_node->left, count, left, &(current_node->left));
+        *right = current_node;
+    }
+
+    update_size(current_node);
+}
+
+// Concatenates two trees, all nodes of left come before those of right
+static node *merge(node *left, node *right)
+{
+    if (!left || !right)
+    {
+        return left ? left : right;
+    }
+
+    if (left->priority > right->priority)
+    {
+        push_down(left);
+        left->right = merge(left->right, right);
+        update_size(left);
+        return left;
+    }
+
+    push_down(right);
+    right->left = merge(left, right->left);
+    update_size(right);
+    return right;
+}
+
+static node *create_node(list *lst, int data)
+{
+    node *new_node = (node *)allocate_from_pool(&(lst->pool));
+    new_node->data = data;
+    new_node->size = 1;
+    new_node->priority = next_priority();
+    new_node->is_reversed = 0;
+    new_node->left = NULL;
+    new_node->right = NULL;
+    return new_node;
+}
+
+// Builds a treap holding values in order in O(n). The right spine is kept
+// on a stack, a node is final (and its size known) once it is popped.
+static node *build_tree(list *lst, const int *values, int num_values)
+{
+    node **spine = (node **)malloc(num_values * sizeof(node *));
+    int spine_size = 0;
+
+    for (int i = 0; i < num_values; i++)
+    {
+        node *new_node = create_node(lst, values[i]);
+        node *last_popped = NULL;
+
+        while (spine_size && spine[spine_size - 1]->priority < new_node->priority)
+        {
+            last_popped = spine[--spine_size];
+            update_size(last_popped);
+        }
+
+        new_node->left = last_popped;
+        if (spine_size)
+        {
+            spine[spine_size - 1]->right = new_node;
+        }
+        spine[spine_size++] = new_node;
+    }
+
+    while (spine_size > 1)
+    {
+        update_size(spine[--spine_size]);
+    }
+    update_size(spine[0]);
+
+    node *root = spine[0];
+    free(spine);
+    return root;
+}
+
+// Returns every node of the tree to the pool
+static void free_tree(list *lst, node *current_node)
+{
+    if (!current_node)
+    {
+        return;
+    }
+
+    free_tree(lst, current_node->left);
+    free_tree(lst, current_node->right);
+    free_to_pool(&(lst->pool), current_node);
+}
+
+// Copies the tree node by node, pending reversals included
+static node *copy_tree(list *lst, node *current_node)
+{
+    if (!current_node)
+    {
+        return NULL;
+    }
+
+    node *new_node = (node *)allocate_from_pool(&(lst->pool));
+    *new_node = *current_node;
+    new_node->left = copy_tree(lst, current_node->left);
+    new_node->right = copy_tree(lst, current_node->right);
+    return new_node;
+}
+
+static void traverse_tree(node *current_node, traverse_context *traverse_ctx)
+{
+    if (!current_node)
+    {
+        return;
+    }
+
+    push_down(current_node);
+    traverse_tree(current_node->left, traverse_ctx);
+
+    traverse_ctx->values[traverse_ctx->num_values++] = current_node->data;
+    if (traverse_ctx->num_values == TRAVERSE_BATCH_SIZE)
+    {
+        traverse_ctx->visit(traverse_ctx->values, traverse_ctx->num_values, traverse_ctx->context);
+        traverse_ctx->num_values = 0;
+    }
+
+    traverse_tree(current_node->right, traverse_ctx);
+}
+
+// Copies the tree into pool in order, pushing pending reversals down on
+// the way so that in-order matches list order
+static node *compact_tree(node_pool *pool, node *current_node)
+{
+    if (!current_node)
+    {
+        return NULL;
+    }
+
+    push_down(current_node);
+    node *left = compact_tree(pool, current_node->left);
+
+    node *new_node = (node *)allocate_from_pool(pool);
+    *new_node = *current_node;
+    new_node->left = left;
+    new_node->right = compact_tree(pool, current_node->right);
+    return new_node;
+}
+
+static void count_adjacent(node *current_node, locality_context *locality_ctx)
+{
+    if (!current_node)
+    {
+        return;
+    }
+
+    push_down(current_node);
+    count_adjacent(current_node->left, locality_ctx);
+
+    if (locality_ctx->previous && locality_ctx->previous + 1 == current_node)
+    {
+        locality_ctx->num_adjacent++;
+    }
+    locality_ctx->previous = current_node;
+
+    count_adjacent(current_node->right, locality_ctx);
+}
+
+// Counts an insert or delete and compacts the list once
+// compact_interval of them add up
+static void count_mutation(list *lst)
+{
+    if (compact_interval && ++lst->num_mutations >= compact_interval)
+    {
+        list_compact(lst);
+    }
+}
+
+void init_list(list *lst)
+{
+    lst->root = NULL;
+    init_pool(&(lst->pool), sizeof(node));
+    lst->num_mutations = 0;
+}
+
+int get_list_length(list *lst)
+{
+    return get_size(lst->root);
+}
+
+// Inserts a new node with data value at index (counting from head
+// starting at 0).
+// Note: index is guaranteed to be valid.
+void insert_node_at(list *lst, int index, int data)
+{
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, create_node(lst, data)), right);
+    count_mutation(lst);
+}
+
+// Inserts num_values new nodes with the given data values, the first
+// one at index, by merging in a treap built from values in O(n).
+// Note: index is guaranteed to be valid.
+void insert_range_at(list *lst, int index, const int *values, int num_values)
+{
+    if (num_values <= 0)
+    {
+        return;
+    }
+
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, build_tree(lst, values, num_values)), right);
+    count_mutation(lst);
+}
+
+// Deletes node at index (counting from head starting from 0).
+// Note: index is guarenteed to be valid.
+void delete_node_at(list *lst, int index)
+{
+    node *left, *middle, *right;
+    split(lst->root, index, &left, &right);
+    split(right, 1, &middle, &right);
+    lst->root = merge(left, right);
+
+    // clean up
+    free_to_pool(&(lst->pool), middle);
+    count_mutation(lst);
+}
+
+// Deletes the count nodes starting at index by splitting them off as
+// one subtree.
+// Note: index and count are guaranteed to be valid.
+void delete_range(list *lst, int index, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    node *left, *middle, *right;
+    split(lst->root, index, &left, &right);
+    split(right, count, &middle, &right);
+    lst->root = merge(left, right);
+
+    // clean up
+    free_tree(lst, middle);
+    count_mutation(lst);
+}
+
+// Merges the tree of other in at index in O(log n). The slabs of other
+// move to lst with its nodes.
+// Note: index is guaranteed to be valid.
+void splice_list(list *lst, list *other, int index)
+{
+    node *left, *right;
+    split(lst->root, index, &left, &right);
+    lst->root = merge(merge(left, other->root), right);
+    merge_pool(&(lst->pool), &(other->pool));
+
+    other->root = NULL;
+    count_mutation(lst);
+}
+
+// Rotates list by the given offset.
+// Note: offset is guarenteed to be non-negative.
+void rotate_list(list *lst, int offset)
+{
+    int length = get_list_length(lst);
+
+    if (length <= 1 || offset % length == 0)
+    {
+        return;
+    }
+
+    node *left, *right;
+    split(lst->root, offset % length, &left, &right);
+    lst->root = merge(right, left);
+}
+
+// Reverses the list, with the original "tail" node
+// becoming the new head node.
+void reverse_list(list *lst)
+{
+    if (lst->root)
+    {
+        lst->root->is_reversed ^= 1;
+    }
+}
+
+// Resets list to an empty state (no nodes) and frees
+// any allocated memory in the process
+void reset_list(list *lst)
+{
+    destroy_pool(&(lst->pool));
+    lst->root = NULL;
+}
+
+// Visits data values from head to tail in batches.
+void traverse_list(list *lst, void (*visit)(const int *values, int num_values, void *context), void *context)
+{
+    traverse_context traverse_ctx;
+    traverse_ctx.num_values = 0;
+    traverse_ctx.visit = visit;
+    traverse_ctx.context = context;
+
+    traverse_tree(lst->root, &traverse_ctx);
+
+    if (traverse_ctx.num_values)
+    {
+        visit(traverse_ctx.values, traverse_ctx.num_values, context);
+    }
+}
+
+// Copies the whole tree into a new list in O(n).
+list *list_fork(list *lst)
+{
+    list *new_lst = (list *)malloc(sizeof(list));
+    init_list(new_lst);
+    new_lst->root = copy_tree(new_lst, lst->root);
+    return new_lst;
+}
+
+// Copies the tree into fresh slabs in list order, so that an in-order
+// walk moves through memory sequentially.
+void list_compact(list *lst)
+{
+    lst->num_mutations = 0;
+
+    node_pool new_pool;
+    init_pool(&new_pool, sizeof(node));
+    node *new_root = compact_tree(&new_pool, lst->root);
+
+    destroy_pool(&(lst->pool));
+    lst->pool = new_pool;
+    lst->root = new_root;
+}
+
+void set_compact_interval(int interval)
+{
+    compact_interval = interval > 0 ? interval : 0;
+}
+
+double get_hop_locality(list *lst)
+{
+    int length = get_list_length(lst);
+    if (length <= 1)
+    {
+        return 100;
+    }
+
+    locality_context locality_ctx;
+    locality_ctx.previous = NULL;
+    locality_ctx.num_adjacent = 0;
+    count_adjacent(lst->root, &locality_ctx);
+
+    return 100.0 * locality_ctx.num_adjacent / (length - 1);
+}
@@ -0,0 +1,159 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "output_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// "00" to "99", so that two digits are produced per division
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes all iovecs, retrying on short writes
+static int write_vector(int fd, struct iovec *vector, int num_vectors)
+{
+    while (num_vectors > 0)
+    {
+        ssize_t num_written = writev(fd, vector, num_vectors);
+        if (num_written == -1)
+        {
+            perror("write_vector: writev error");
+            return -1;
+        }
+
+        while (num_vectors > 0 && (size_t)num_written >= vector->iov_len)
+        {
+            num_written -= vector->iov_len;
+            vector++;
+            num_vectors--;
+        }
+
+        if (num_vectors > 0)
+        {
+            vector->iov_base = (char *)vector->iov_base + num_written;
+            vector->iov_len -= num_written;
+        }
+    }
+
+    return 0;
+}
+
+// Formats value backwards from end, returns the first character
+static char *format_long(char *end, long value)
+{
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    char *position = end;
+
+    while (magnitude >= 100)
+    {
+        const char *pair = digit_pairs + (magnitude % 100) * 2;
+        magnitude /= 100;
+        *--position = pair[1];
+        *--position = pair[0];
+    }
+
+    if (magnitude >= 10)
+    {
+        const char *pair = digit_pairs + magnitude * 2;
+        *--position = pair[1];
+        *--position = pair[0];
+    }
+    else
+    {
+        *--position = '0' + magnitude;
+    }
+
+    if (value < 0)
+    {
+        *--position = '-';
+    }
+
+    return position;
+}
+
+int open_writer(output_writer *writer, int fd)
+{
+    writer->fd = fd;
+    writer->size = 0;
+    writer->data = (char *)malloc(WRITE_BLOCK_SIZE);
+
+    if (!writer->data)
+    {
+        perror("open_writer: malloc error");
+        return -1;
+    }
+
+    return 0;
+}
+
+void write_string(output_writer *writer, const char *string, size_t length)
+{
+    if (writer->size + length <= WRITE_BLOCK_SIZE)
+    {
+        memcpy(writer->data + writer->size, string, length);
+        writer->size += length;
+        return;
+    }
+
+    // hand the buffer and the string to the kernel together instead of
+    // copying a large string through the buffer
+    struct iovec vector[2] = {
+        {.iov_base = writer->data, .iov_len = writer->size},
+        {.iov_base = (void *)string, .iov_len = length},
+    };
+    write_vector(writer->fd, vector, 2);
+    writer->size = 0;
+}
+
+void write_long(output_writer *writer, long value, char separator)
+{
+    if (writer->size + MAX_FORMATTED_SIZE > WRITE_BLOCK_SIZE)
+    {
+        flush_writer(writer);
+    }
+
+    char formatted[MAX_FORMATTED_SIZE];
+    char *end = formatted + MAX_FORMATTED_SIZE;
+    *--end = separator;
+    char *start = format_long(end, value);
+
+    size_t length = formatted + MAX_FORMATTED_SIZE - start;
+    memcpy(writer->data + writer->size, start, length);
+    writer->size += length;
+}
+
+int flush_writer(output_writer *writer)
+{
+    if (!writer->size)
+    {
+        return 0;
+    }
+
+    struct iovec vector = {.iov_base = writer->data, .iov_len = writer->size};
+    writer->size = 0;
+    return write_vector(writer->fd, &vector, 1);
+}
+
+void close_writer(output_writer *writer)
+{
+    flush_writer(writer);
+    free(writer->data);
+    writer->data = NULL;
+}
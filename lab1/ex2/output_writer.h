@@ -0,0 +1,37 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stddef.h>
+
+#define WRITE_BLOCK_SIZE (1 << 20)
+// enough for "-9223372036854775808" and a separator
+#define MAX_FORMATTED_SIZE 24
+
+// Formats output into a large buffer that is only handed to the kernel
+// when it is full or on flush_writer, so that printing a long list costs
+// a handful of write calls instead of one stdio call per value.
+typedef struct
+{
+    int fd;
+    char *data;
+    size_t size;
+} output_writer;
+
+// returns 0 on success else -1
+int open_writer(output_writer *writer, int fd);
+void write_string(output_writer *writer, const char *string, size_t length);
+// Writes value in decimal followed by separator
+void write_long(output_writer *writer, long value, char separator);
+// returns 0 on success else -1
+int flush_writer(output_writer *writer);
+// Flushes and frees the buffer
+void close_writer(output_writer *writer);
+
+#endif
@@ -0,0 +1,51 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "instruction_reader.h"
+#include "node.h"
+
+// Macros
+#define PRINT_LIST 0
+#define INSERT_AT 1
+#define DELETE_AT 2
+#define ROTATE_LIST 3
+#define REVERSE_LIST 4
+#define RESET_LIST 5
+// id, the list is written to / replaced by SNAPSHOT_FILE_FORMAT with id
+#define SAVE_LIST 6
+#define LOAD_LIST 7
+
+// index, count, count values
+#define INSERT_RANGE 8
+// index, count
+#define DELETE_RANGE 9
+// index, count, count values that are built into a list of their own
+// and spliced in
+#define SPLICE 10
+// id, the list is forked into / replaced by a fork of slot id
+#define FORK_LIST 11
+#define RESTORE_LIST 12
+// compacts the list and reports the hop locality before and after
+#define COMPACT_LIST 13
+
+#define MAX_FORKS 64
+
+#define SNAPSHOT_FILE_FORMAT "list_%d.snapshot"
+
+void run_instruction(list *lst, int instr, instruction_reader *reader);
+void print_list(list *lst);
+void save_snapshot(list *lst, int id);
+void load_snapshot(list *lst, int id);
+void splice_values(list *lst, int index, const int *values, int num_values);
+void fork_to_slot(list *lst, int id);
+void restore_from_slot(list *lst, int id);
+void compact_and_report(list *lst);
+
+#endif
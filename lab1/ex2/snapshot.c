@@ -0,0 +1,204 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define WRITE_BUFFER_SIZE 16384
+
+typedef struct
+{
+    int fd;
+    int values[WRITE_BUFFER_SIZE];
+    int num_values;
+    unsigned int sum;
+    unsigned int checksum;
+    int has_error;
+} save_context;
+
+static int check_syscall(int value, const char *error_msg)
+{
+    if (value == -1)
+    {
+        perror(error_msg);
+    }
+    return value;
+}
+
+static void update_checksum(unsigned int *sum, unsigned int *checksum, const int *values, int num_values)
+{
+    for (int i = 0; i < num_values; i++)
+    {
+        *sum += (unsigned int)values[i];
+        *checksum += *sum;
+    }
+}
+
+// Writes all of buffer, retrying on short writes
+static int write_all(int fd, const void *buffer, size_t size)
+{
+    const char *position = (const char *)buffer;
+
+    while (size > 0)
+    {
+        ssize_t num_written = write(fd, position, size);
+        if (num_written == -1)
+        {
+            perror("write_all: write error");
+            return -1;
+        }
+        position += num_written;
+        size -= num_written;
+    }
+
+    return 0;
+}
+
+static void flush_values(save_context *save_ctx)
+{
+    if (!save_ctx->has_error && write_all(save_ctx->fd, save_ctx->values, save_ctx->num_values * sizeof(int)) != 0)
+    {
+        save_ctx->has_error = 1;
+    }
+    save_ctx->num_values = 0;
+}
+
+static void save_values(const int *values, int num_values, void *context)
+{
+    save_context *save_ctx = (save_context *)context;
+    update_checksum(&(save_ctx->sum), &(save_ctx->checksum), values, num_values);
+
+    if (save_ctx->num_values + num_values > WRITE_BUFFER_SIZE)
+    {
+        flush_values(save_ctx);
+    }
+
+    memcpy(save_ctx->values + save_ctx->num_values, values, num_values * sizeof(int));
+    save_ctx->num_values += num_values;
+}
+
+// The header is written last, once the checksum is known, so fd has to
+// be seekable
+int list_save(list *lst, int fd)
+{
+    // checked as an off_t, an int would cut off offsets past 2 GiB
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    if (start == -1)
+    {
+        perror("list_save: lseek error");
+        return -1;
+    }
+
+    snapshot_header header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.num_values = get_list_length(lst);
+    header.checksum = 0;
+
+    if (write_all(fd, &header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+
+    save_context *save_ctx = (save_context *)malloc(sizeof(save_context));
+    if (!save_ctx)
+    {
+        perror("list_save: malloc error");
+        return -1;
+    }
+    save_ctx->fd = fd;
+    save_ctx->num_values = 0;
+    save_ctx->sum = 0;
+    save_ctx->checksum = 0;
+    save_ctx->has_error = 0;
+
+    traverse_list(lst, save_values, save_ctx);
+    flush_values(save_ctx);
+
+    header.checksum = save_ctx->checksum;
+    int has_error = save_ctx->has_error;
+    free(save_ctx);
+
+    if (has_error)
+    {
+        return -1;
+    }
+
+    ssize_t num_written = pwrite(fd, &header, sizeof(header), start);
+    if (num_written != (ssize_t)sizeof(header))
+    {
+        if (num_written == -1)
+        {
+            perror("list_save: pwrite error");
+        }
+        else
+        {
+            fprintf(stderr, "list_save: short pwrite of header\n");
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+list *list_load(int fd)
+{
+    struct stat file_stat;
+    if (check_syscall(fstat(fd, &file_stat), "list_load: fstat error") == -1)
+    {
+        return NULL;
+    }
+
+    if ((size_t)file_stat.st_size < sizeof(snapshot_header))
+    {
+        fprintf(stderr, "list_load: snapshot too small\n");
+        return NULL;
+    }
+
+    char *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("list_load: mmap error");
+        return NULL;
+    }
+    madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+
+    snapshot_header *header = (snapshot_header *)data;
+    const int *values = (const int *)(data + sizeof(snapshot_header));
+    unsigned int sum = 0, checksum = 0;
+    list *lst = NULL;
+
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        (size_t)file_stat.st_size != sizeof(snapshot_header) + (size_t)header->num_values * sizeof(int))
+    {
+        fprintf(stderr, "list_load: malformed snapshot\n");
+        goto cleanup;
+    }
+
+    update_checksum(&sum, &checksum, values, header->num_values);
+    if (checksum != header->checksum)
+    {
+        fprintf(stderr, "list_load: checksum mismatch\n");
+        goto cleanup;
+    }
+
+    lst = (list *)malloc(sizeof(list));
+    init_list(lst);
+    insert_range_at(lst, 0, values, header->num_values);
+
+cleanup:
+    munmap(data, file_stat.st_size);
+    return lst;
+}
@@ -0,0 +1,32 @@
+/*************************************
+* Lab 1 Exercise 2
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "node.h"
+
+#define SNAPSHOT_MAGIC "LSNP"
+#define SNAPSHOT_VERSION 1
+
+// A snapshot is this header followed by num_values native ints in head to
+// tail order. checksum is a Fletcher style checksum over the values.
+typedef struct
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int num_values;
+    unsigned int checksum;
+} snapshot_header;
+
+// Writes the values of lst to fd, returns 0 on success else -1
+int list_save(list *lst, int fd);
+// Builds a new list from a snapshot in fd, returns NULL if the snapshot
+// is malformed or corrupted
+list *list_load(int fd);
+
+#endif
@@ -0,0 +1,234 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "bytecode.h"
+#include "function_pointers.h"
+#include "runner.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INITIAL_CAPACITY 1024
+#define NO_POSITION ((size_t)-1)
+
+static void emit(bytecode_program *program, int word)
+{
+    if (program->size == program->capacity)
+    {
+        program->capacity *= 2;
+        program->code = (int *)realloc(program->code, program->capacity * sizeof(int));
+    }
+
+    program->code[program->size++] = word;
+}
+
+// Starts an OP_INSERT_RANGE for count values at index, or extends the
+// last one if the values go right after it. The values are emitted by
+// the caller.
+static void emit_insert(bytecode_program *program, size_t *last_position, int index, int count)
+{
+    if (*last_position != NO_POSITION &&
+        program->code[*last_position] == OP_INSERT_RANGE &&
+        program->code[*last_position + 1] + program->code[*last_position + 2] == index)
+    {
+        program->code[*last_position + 2] += count;
+        return;
+    }
+
+    *last_position = program->size;
+    emit(program, OP_INSERT_RANGE);
+    emit(program, index);
+    emit(program, count);
+}
+
+static void emit_values(bytecode_program *program, instruction_reader *reader, int count)
+{
+    int data;
+    for (int i = 0; i < count; i++)
+    {
+        read_int(reader, &data);
+        emit(program, data);
+    }
+}
+
+void compile_program(instruction_reader *reader, bytecode_program *program)
+{
+    program->size = 0;
+    program->capacity = INITIAL_CAPACITY;
+    program->code = (int *)malloc(program->capacity * sizeof(int));
+
+    // position of the last emitted opcode if it can still be extended
+    size_t last_position = NO_POSITION;
+    int instr, index, data, offset, count;
+
+    while (read_int(reader, &instr))
+    {
+        switch (instr)
+        {
+        case SUM_LIST:
+            emit(program, OP_SUM_LIST);
+            last_position = NO_POSITION;
+            break;
+        case INSERT_AT:
+            read_int(reader, &index);
+            read_int(reader, &data);
+
+            emit_insert(program, &last_position, index, 1);
+            emit(program, data);
+            break;
+        case INSERT_RANGE:
+            read_int(reader, &index);
+            read_int(reader, &count);
+            emit_insert(program, &last_position, index, count);
+            emit_values(program, reader, count);
+            break;
+        case DELETE_RANGE:
+            read_int(reader, &index);
+            read_int(reader, &count);
+            emit(program, OP_DELETE_RANGE);
+            emit(program, index);
+            emit(program, count);
+            last_position = NO_POSITION;
+            break;
+        case SPLICE:
+            read_int(reader, &index);
+            read_int(reader, &count);
+            emit(program, OP_SPLICE);
+            emit(program, index);
+            emit(program, count);
+            emit_values(program, reader, count);
+            last_position = NO_POSITION;
+            break;
+        case DELETE_AT:
+            read_int(reader, &index);
+            emit(program, OP_DELETE_AT);
+            emit(program, index);
+            last_position = NO_POSITION;
+            break;
+        case ROTATE_LIST:
+            read_int(reader, &offset);
+
+            if (last_position != NO_POSITION &&
+                program->code[last_position] == OP_ROTATE_LIST &&
+                program->code[last_position + 1] <= INT_MAX - offset)
+            {
+                program->code[last_position + 1] += offset;
+                break;
+            }
+
+            last_position = program->size;
+            emit(program, OP_ROTATE_LIST);
+            emit(program, offset);
+            break;
+        case REVERSE_LIST:
+            if (last_position != NO_POSITION && program->code[last_position] == OP_REVERSE_LIST)
+            {
+                program->size = last_position;
+                last_position = NO_POSITION;
+                break;
+            }
+
+            last_position = program->size;
+            emit(program, OP_REVERSE_LIST);
+            break;
+        case RESET_LIST:
+            emit(program, OP_RESET_LIST);
+            last_position = NO_POSITION;
+            break;
+        case MAP:
+            read_int(reader, &index);
+            emit(program, OP_MAP);
+            emit(program, index);
+            last_position = NO_POSITION;
+        }
+    }
+
+    emit(program, OP_HALT);
+}
+
+// Threaded interpreter, every handler jumps straight to the next one
+void run_program(list *lst, bytecode_program *program)
+{
+    static void *dispatch_table[] = {
+        [OP_HALT] = &&op_halt,
+        [OP_SUM_LIST] = &&op_sum_list,
+        [OP_INSERT_RANGE] = &&op_insert_range,
+        [OP_DELETE_AT] = &&op_delete_at,
+        [OP_ROTATE_LIST] = &&op_rotate_list,
+        [OP_REVERSE_LIST] = &&op_reverse_list,
+        [OP_RESET_LIST] = &&op_reset_list,
+        [OP_MAP] = &&op_map,
+        [OP_DELETE_RANGE] = &&op_delete_range,
+        [OP_SPLICE] = &&op_splice,
+    };
+
+    const int *pc = program->code;
+
+#define DISPATCH() goto *dispatch_table[*pc++]
+
+    DISPATCH();
+
+op_sum_list:
+    print_sum(lst);
+    DISPATCH();
+
+op_insert_range:
+    if (pc[1] == 1)
+    {
+        insert_node_at(lst, pc[0], pc[2]);
+    }
+    else
+    {
+        insert_range_at(lst, pc[0], pc + 2, pc[1]);
+    }
+    pc += 2 + pc[1];
+    DISPATCH();
+
+op_delete_at:
+    delete_node_at(lst, *pc++);
+    DISPATCH();
+
+op_rotate_list:
+    rotate_list(lst, *pc++);
+    DISPATCH();
+
+op_reverse_list:
+    reverse_list(lst);
+    DISPATCH();
+
+op_reset_list:
+    reset_list(lst);
+    DISPATCH();
+
+op_map:
+    apply_function(lst, *pc++);
+    DISPATCH();
+
+op_delete_range:
+    delete_range(lst, pc[0], pc[1]);
+    pc += 2;
+    DISPATCH();
+
+op_splice:
+    splice_values(lst, pc[0], pc + 2, pc[1]);
+    pc += 2 + pc[1];
+    DISPATCH();
+
+#undef DISPATCH
+
+op_halt:
+    return;
+}
+
+void free_program(bytecode_program *program)
+{
+    free(program->code);
+    program->code = NULL;
+    program->size = 0;
+    program->capacity = 0;
+}
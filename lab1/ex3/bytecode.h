@@ -0,0 +1,47 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "instruction_reader.h"
+#include "node.h"
+
+// Bytecode opcodes, every opcode word is followed by its operand words
+#define OP_HALT 0
+#define OP_SUM_LIST 1
+// index, number of values, values
+#define OP_INSERT_RANGE 2
+// index
+#define OP_DELETE_AT 3
+// offset
+#define OP_ROTATE_LIST 4
+#define OP_REVERSE_LIST 5
+#define OP_RESET_LIST 6
+// index into func_list
+#define OP_MAP 7
+// index, count
+#define OP_DELETE_RANGE 8
+// index, number of values, values
+#define OP_SPLICE 9
+
+// Whole instruction stream compiled into a flat array of words
+typedef struct
+{
+    int *code;
+    size_t size;
+    size_t capacity;
+} bytecode_program;
+
+// Compiles every instruction left in reader. Runs of INSERT_AT and
+// INSERT_RANGE at consecutive indices are fused into one OP_INSERT_RANGE,
+// consecutive rotations are added up and pairs of reversals are dropped.
+void compile_program(instruction_reader *reader, bytecode_program *program);
+void run_program(list *lst, bytecode_program *program);
+void free_program(bytecode_program *program);
+
+#endif
@@ -2,13 +2,45 @@
 
 make clean
 make
-./ex3 sample.in | diff sample.out -
-./ex3 small_test.in | diff small_test.out -
-./ex3 big_test.in | diff big_test.out -
+make unrolled
+make plugin
+for binary in ./ex3 ./ex3_unrolled "./ex3 --bytecode" "./ex3_unrolled --bytecode" "./ex3 --profile" "./ex3_unrolled --profile-json" "./ex3 --pipeline" "./ex3_unrolled --pipeline --bytecode"
+do
+    $binary sample.in 2>/dev/null | diff sample.out -
+    $binary small_test.in 2>/dev/null | diff small_test.out -
+    $binary big_test.in 2>/dev/null | diff big_test.out -
+    $binary range_test.in 2>/dev/null | diff range_test.out -
+    $binary --plugin ./plugin_example.so:negate --plugin ./plugin_example.so:halve plugin_test.in 2>/dev/null | diff plugin_test.out -
+done
+
+# every file on its own list, output in file order
+for binary in ./ex3 ./ex3_unrolled "./ex3 --bytecode"
+do
+    $binary --jobs 4 sample.in small_test.in big_test.in range_test.in | diff <(cat sample.out small_test.out big_test.out range_test.out) -
+done
+
+# a list above PARALLEL_THRESHOLD that is built by inserts, so that its
+# first map already has to be split among the threads
+parallel_test=$(mktemp)
+{
+    echo "7 0 100000 $(seq 1 100000 | tr '\n' ' ')"
+    echo "6 3"; echo "0"
+    echo "1 500 7"; echo "3 40000"
+    echo "6 4"; echo "0"
+    echo "8 10 30000"; echo "4"
+    echo "6 3"; echo "0"
+} > $parallel_test
+for threads in 2 4 8
+do
+    ./ex3 --threads $threads $parallel_test | diff <(./ex3 $parallel_test) -
+done
+rm $parallel_test
 
 if command -v valgrind
 then
     valgrind ./ex3 sample.in
     valgrind ./ex3 small_test.in
     valgrind ./ex3 big_test.in
+    valgrind ./ex3_unrolled big_test.in
+    valgrind ./ex3 --bytecode big_test.in
 fi
@@ -5,11 +5,18 @@
 * Lab Group: 18
 *************************************/
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "bytecode.h"
 #include "function_pointers.h"
-#include "node.h"
+#include "output_writer.h"
+#include "profiler.h"
+#include "sharded_runner.h"
+#include "runner.h"
 
 // The runner is empty now! Modify it to fulfill the requirements of the
 // exercise. You can use ex2.c as a template
@@ -17,27 +24,107 @@
 // DO NOT initialize the func_list array in this file. All initialization
 // logic for func_list should go into function_pointers.c.
 
-// Macros
-#define SUM_LIST 0
-#define INSERT_AT 1
-#define DELETE_AT 2
-#define ROTATE_LIST 3
-#define REVERSE_LIST 4
-#define RESET_LIST 5
-#define MAP 6
+#define BYTECODE_FLAG "--bytecode"
+#define THREADS_FLAG "--threads"
+#define PROFILE_FLAG "--profile"
+#define PROFILE_JSON_FLAG "--profile-json"
+#define PLUGIN_FLAG "--plugin"
+#define JOBS_FLAG "--jobs"
+#define PIPELINE_FLAG "--pipeline"
 
-void run_instruction(list *lst, int instr, FILE *fp);
+// everything printed to stdout goes through this buffer
+static output_writer stdout_writer;
+// where print_sum writes to, each worker of a sharded run has its own
+static __thread output_writer *current_writer = &stdout_writer;
+
+int *read_values(instruction_reader *reader, int num_values);
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    // compile the whole input before running it
+    int is_bytecode_mode = 0;
+    // per opcode latencies, printed to stderr on exit
+    int is_profiling = 0;
+    int profile_format = PROFILE_TABLE;
+    // runs every file on its own list with this many workers
+    int num_jobs = 0;
+    // decode the input on a reader thread while running it
+    int is_pipelined = 0;
+    int num_files = 0;
+    char **fnames = (char **)malloc(argc * sizeof(char *));
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], BYTECODE_FLAG) == 0)
+        {
+            is_bytecode_mode = 1;
+        }
+        else if (strcmp(argv[i], PROFILE_FLAG) == 0 || strcmp(argv[i], PROFILE_JSON_FLAG) == 0)
+        {
+            is_profiling = 1;
+            profile_format = strcmp(argv[i], PROFILE_JSON_FLAG) == 0 ? PROFILE_JSON : PROFILE_TABLE;
+        }
+        else if (strcmp(argv[i], PLUGIN_FLAG) == 0 && i + 1 < argc)
+        {
+            // path:symbol of a batch transform, numbered in load order
+            // after the built in functions
+            char *plugin = argv[++i];
+            char *separator = strrchr(plugin, ':');
+            if (!separator)
+            {
+                fprintf(stderr, "Error: expecting %s path:symbol\n", PLUGIN_FLAG);
+                exit(1);
+            }
+
+            *separator = '\0';
+            if (load_plugin(plugin, separator + 1) == -1)
+            {
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], THREADS_FLAG) == 0 && i + 1 < argc)
+        {
+            // threads used by map on large lists
+            set_num_threads(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], PIPELINE_FLAG) == 0)
+        {
+            is_pipelined = 1;
+        }
+        else if (strcmp(argv[i], JOBS_FLAG) == 0 && i + 1 < argc)
+        {
+            num_jobs = atoi(argv[++i]);
+            num_jobs = num_jobs < 1 ? 1 : num_jobs;
+        }
+        else
+        {
+            fnames[num_files++] = argv[i];
+        }
+    }
+
+    if (num_files != 1 && !(num_jobs && num_files > 0))
+    {
+        fprintf(stderr, "Error: expecting 1 argument, %d found\n", num_files);
+        exit(1);
+    }
+
+    if (is_profiling && is_bytecode_mode)
     {
-        fprintf(stderr, "Error: expecting 1 argument, %d found\n", argc - 1);
+        fprintf(stderr, "Error: %s cannot be used with %s\n", PROFILE_FLAG, BYTECODE_FLAG);
         exit(1);
     }
 
-    // We read in the file name provided as argument
-    char *fname = argv[1];
+    if (is_profiling && num_jobs)
+    {
+        fprintf(stderr, "Error: %s cannot be used with %s\n", PROFILE_FLAG, JOBS_FLAG);
+        exit(1);
+    }
+
+    if (is_pipelined && num_jobs)
+    {
+        fprintf(stderr, "Error: %s cannot be used with %s\n", PIPELINE_FLAG, JOBS_FLAG);
+        exit(1);
+    }
 
     // Update the array of function pointers
     // DO NOT REMOVE THIS CALL
@@ -45,46 +132,106 @@ int main(int argc, char **argv)
     update_functions();
 
     // Rest of code logic here
-    FILE *fp = fopen(fname, "r");
+    if (open_writer(&stdout_writer, STDOUT_FILENO) != 0)
+    {
+        exit(1);
+    }
 
-    if (fp == NULL)
+    if (num_jobs)
+    {
+        int num_failed = run_sharded(fnames, num_files, num_jobs, is_bytecode_mode, &stdout_writer);
+        close_writer(&stdout_writer);
+        free(fnames);
+        unload_plugins();
+        exit(num_failed ? 1 : 0);
+    }
+
+    int fd = open(fnames[0], O_RDONLY);
+    instruction_reader reader;
+
+    if (fd == -1 || open_reader(&reader, fd) != 0)
+    {
+        fprintf(stderr, "Error: invalid file %s\n", fnames[0]);
+        exit(1);
+    }
+
+    if (is_pipelined && start_pipeline(&reader) != 0)
     {
-        fprintf(stderr, "Error: invalid file %s\n", fname);
         exit(1);
     }
 
     list *lst = (list *)malloc(sizeof(list));
-    lst->head = NULL;
+    init_list(lst);
 
-    int instr;
-    while (fscanf(fp, "%d", &instr) == 1)
+    if (is_profiling)
+    {
+        profiler prof;
+        init_profiler(&prof, profile_format);
+
+        int instr;
+        while (read_int(&reader, &instr))
+        {
+            profile_instruction(&prof, lst, instr, &reader);
+        }
+        print_profile(&prof, lst);
+    }
+    else
     {
-        run_instruction(lst, instr, fp);
+        run_stream(lst, &reader, is_bytecode_mode);
     }
 
-    fclose(fp);
+    close_reader(&reader);
+    close(fd);
+    close_writer(&stdout_writer);
     reset_list(lst);
     free(lst);
+    free(fnames);
+    unload_plugins();
 }
 
-void run_instruction(list *lst, int instr, FILE *fp)
+void run_stream(list *lst, instruction_reader *reader, int is_bytecode_mode)
 {
-    int index, data, offset;
+    if (is_bytecode_mode)
+    {
+        bytecode_program program;
+        compile_program(reader, &program);
+        run_program(lst, &program);
+        free_program(&program);
+        return;
+    }
+
+    int instr;
+    while (read_int(reader, &instr))
+    {
+        run_instruction(lst, instr, reader);
+    }
+}
+
+void set_output_writer(output_writer *writer)
+{
+    current_writer = writer ? writer : &stdout_writer;
+}
+
+void run_instruction(list *lst, int instr, instruction_reader *reader)
+{
+    int index, data, offset, count;
+    int *values;
     switch (instr)
     {
     case SUM_LIST:
-        printf("%ld\n", sum_list(lst));
+        print_sum(lst);
         break;
     case INSERT_AT:
-        fscanf(fp, "%d %d", &index, &data);
+        read_int(reader, &index);
+        read_int(reader, &data);
         insert_node_at(lst, index, data);
         break;
     case DELETE_AT:
-        fscanf(fp, "%d", &index);
+        read_int(reader, &index);
         delete_node_at(lst, index);
         break;
     case ROTATE_LIST:
-        fscanf(fp, "%d", &offset);
+        read_int(reader, &offset);
         rotate_list(lst, offset);
         break;
     case REVERSE_LIST:
@@ -94,7 +241,71 @@ void run_instruction(list *lst, int instr, FILE *fp)
         reset_list(lst);
         break;
     case MAP:
-        fscanf(fp, "%d", &index);
+        read_int(reader, &index);
+        apply_function(lst, index);
+        break;
+    case INSERT_RANGE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        values = read_values(reader, count);
+        insert_range_at(lst, index, values, count);
+        free(values);
+        break;
+    case DELETE_RANGE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        delete_range(lst, index, count);
+        break;
+    case SPLICE:
+        read_int(reader, &index);
+        read_int(reader, &count);
+        values = read_values(reader, count);
+        splice_values(lst, index, values, count);
+        free(values);
+    }
+}
+
+void print_sum(list *lst)
+{
+    write_long(current_writer, sum_list(lst), '\n');
+}
+
+void apply_function(list *lst, int index)
+{
+    // which indices are valid depends on the plugins that were loaded
+    if (index < 0 || index >= NUM_FUNCTIONS + num_plugins)
+    {
+        fprintf(stderr, "Error: invalid map function %d\n", index);
+        return;
+    }
+
+    if (index < NUM_FUNCTIONS)
+    {
         map(lst, func_list[index]);
     }
-}
\ No newline at end of file
+    else
+    {
+        map_batch(lst, plugin_list[index - NUM_FUNCTIONS]);
+    }
+}
+
+// Reads the operand values of a range instruction into a new array
+int *read_values(instruction_reader *reader, int num_values)
+{
+    int *values = (int *)malloc((num_values > 0 ? num_values : 1) * sizeof(int));
+    for (int i = 0; i < num_values; i++)
+    {
+        read_int(reader, &values[i]);
+    }
+    return values;
+}
+
+// Builds the values into a list of their own and splices it in at index
+void splice_values(list *lst, int index, const int *values, int num_values)
+{
+    list other;
+    init_list(&other);
+    insert_range_at(&other, 0, values, num_values);
+    splice_list(lst, &other, index);
+    reset_list(&other);
+}
@@ -5,8 +5,12 @@
 * Lab Group: 18
 *************************************/
 
+#include "function_pointers.h"
 #include "functions.h"
 
+#include <dlfcn.h>
+#include <stdio.h>
+
 #define ADD_ONE 0
 #define ADD_TWO 1
 #define MULTIPLY_FIVE 2
@@ -14,7 +18,11 @@
 #define CUBE 4
 
 // Initialize the func_list array here!
-int (*func_list[5])(int);
+int (*func_list[NUM_FUNCTIONS])(int);
+
+void (*plugin_list[MAX_PLUGINS])(int *values, size_t num_values);
+int num_plugins = 0;
+static void *plugin_handles[MAX_PLUGINS];
 
 // You can also use this function to help you with
 // the initialization. This will be called in ex3.c.
@@ -26,3 +34,77 @@ void update_functions()
     func_list[SQUARE] = square;
     func_list[CUBE] = cube;
 }
+
+int load_plugin(const char *path, const char *symbol)
+{
+    if (num_plugins == MAX_PLUGINS)
+    {
+        fprintf(stderr, "load_plugin: at most %d plugins can be loaded\n", MAX_PLUGINS);
+        return -1;
+    }
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+    {
+        fprintf(stderr, "load_plugin: %s\n", dlerror());
+        return -1;
+    }
+
+    // the detour through a data pointer is how POSIX casts dlsym results
+    void (*batch_func)(int *, size_t);
+    *(void **)(&batch_func) = dlsym(handle, symbol);
+    if (!batch_func)
+    {
+        fprintf(stderr, "load_plugin: %s\n", dlerror());
+        dlclose(handle);
+        return -1;
+    }
+
+    plugin_handles[num_plugins] = handle;
+    plugin_list[num_plugins] = batch_func;
+    return NUM_FUNCTIONS + num_plugins++;
+}
+
+void unload_plugins()
+{
+    while (num_plugins)
+    {
+        num_plugins--;
+        dlclose(plugin_handles[num_plugins]);
+        plugin_list[num_plugins] = NULL;
+    }
+}
+
+int get_affine_coefficients(int (*func)(int), long *scale, long *offset)
+{
+    if (func == add_one || func == add_two)
+    {
+        *scale = 1;
+        *offset = func == add_one ? 1 : 2;
+        return 1;
+    }
+
+    if (func == multiply_five)
+    {
+        *scale = 5;
+        *offset = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+int get_power_exponent(int (*func)(int))
+{
+    if (func == square)
+    {
+        return 2;
+    }
+
+    if (func == cube)
+    {
+        return 3;
+    }
+
+    return 0;
+}
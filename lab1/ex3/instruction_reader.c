@@ -0,0 +1,307 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "instruction_reader.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Reads the next block of a non-mappable input, keeping any bytes that
+// were not decoded yet (a number cut off by the previous block)
+static void read_block(instruction_reader *reader)
+{
+    size_t num_leftover = reader->end - reader->position;
+    memmove(reader->data, reader->position, num_leftover);
+
+    ssize_t num_read;
+    do
+    {
+        num_read = read(reader->fd, reader->data + num_leftover, READ_BLOCK_SIZE - num_leftover);
+    } while (num_read > 0 && (num_leftover += num_read) < READ_BLOCK_SIZE);
+
+    if (num_read <= 0)
+    {
+        if (num_read < 0)
+        {
+            perror("read_block: read error");
+        }
+        reader->is_eof = 1;
+    }
+
+    reader->position = reader->data;
+    reader->end = reader->data + num_leftover;
+}
+
+// Decodes as many integers as fit into values from the undecoded bytes
+static int decode_batch(instruction_reader *reader, int *values)
+{
+    const char *position = reader->position;
+    const char *end = reader->end;
+    const char *limit = end;
+
+    // a number touching the end of a block may continue in the next one
+    if (!reader->is_eof)
+    {
+        while (limit > position && (is_digit(limit[-1]) || limit[-1] == '-'))
+        {
+            limit--;
+        }
+    }
+
+    int num_values = 0;
+    while (num_values < DECODE_BATCH_SIZE)
+    {
+        while (position < limit && !is_digit(*position) && *position != '-')
+        {
+            position++;
+        }
+
+        if (position == limit)
+        {
+            break;
+        }
+
+        int is_negative = *position == '-';
+        position += is_negative;
+
+        long value = 0;
+        while (position < limit && is_digit(*position))
+        {
+            value = value * 10 + (*position - '0');
+            position++;
+        }
+
+        values[num_values++] = (int)(is_negative ? -value : value);
+    }
+
+    reader->position = position;
+    return num_values;
+}
+
+// Decodes the next non-empty batch into values, reading more blocks as
+// needed. Returns 0 once the input is used up.
+static int fill_batch(instruction_reader *reader, int *values)
+{
+    while (!(reader->position == reader->end && reader->is_eof))
+    {
+        int num_values = decode_batch(reader, values);
+        if (num_values)
+        {
+            return num_values;
+        }
+
+        if (reader->is_eof)
+        {
+            reader->position = reader->end;
+            return 0;
+        }
+        read_block(reader);
+    }
+
+    return 0;
+}
+
+// Waits for the other side of the ring to move. Both threads may share a
+// core, so after a few spins the slot is handed over with sched_yield.
+static void wait_for_ring(int *num_spins)
+{
+    if (++*num_spins > PIPELINE_SPIN_LIMIT)
+    {
+        sched_yield();
+    }
+}
+
+// Reader thread: decodes the whole input into the ring, then publishes an
+// empty batch to mark the end
+static void *decode_pipeline(void *arg)
+{
+    instruction_reader *reader = (instruction_reader *)arg;
+    instruction_pipeline *pipeline = reader->pipeline;
+    unsigned int head = pipeline->head;
+    int num_values;
+
+    do
+    {
+        int num_spins = 0;
+        while (head - __atomic_load_n(&(pipeline->tail), __ATOMIC_ACQUIRE) == PIPELINE_NUM_SLOTS)
+        {
+            wait_for_ring(&num_spins);
+        }
+
+        decoded_batch *slot = &(pipeline->slots[head % PIPELINE_NUM_SLOTS]);
+        num_values = fill_batch(reader, slot->values);
+        slot->num_values = num_values;
+
+        __atomic_store_n(&(pipeline->head), ++head, __ATOMIC_RELEASE);
+    } while (num_values);
+
+    return NULL;
+}
+
+// Hands the consumed slot back to the reader thread and takes the next
+// one. Returns 0 at the end of the input.
+static int next_pipeline_batch(instruction_reader *reader)
+{
+    instruction_pipeline *pipeline = reader->pipeline;
+    unsigned int tail = pipeline->tail;
+
+    if (pipeline->is_done)
+    {
+        return 0;
+    }
+
+    if (reader->batch != reader->values)
+    {
+        __atomic_store_n(&(pipeline->tail), ++tail, __ATOMIC_RELEASE);
+    }
+
+    int num_spins = 0;
+    while (__atomic_load_n(&(pipeline->head), __ATOMIC_ACQUIRE) == tail)
+    {
+        wait_for_ring(&num_spins);
+    }
+
+    decoded_batch *slot = &(pipeline->slots[tail % PIPELINE_NUM_SLOTS]);
+    reader->batch = slot->values;
+    reader->num_values = slot->num_values;
+    reader->next_value = 0;
+
+    pipeline->is_done = slot->num_values == 0;
+    return !pipeline->is_done;
+}
+
+int open_reader(instruction_reader *reader, int fd)
+{
+    struct stat file_stat;
+
+    reader->fd = fd;
+    reader->is_mapped = 0;
+    reader->is_eof = 0;
+    reader->batch = reader->values;
+    reader->num_values = 0;
+    reader->next_value = 0;
+    reader->pipeline = NULL;
+
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0)
+    {
+        reader->data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (reader->data != MAP_FAILED)
+        {
+            madvise(reader->data, file_stat.st_size, MADV_SEQUENTIAL);
+            reader->is_mapped = 1;
+            reader->is_eof = 1;
+            reader->data_size = file_stat.st_size;
+            reader->position = reader->data;
+            reader->end = reader->data + reader->data_size;
+            return 0;
+        }
+    }
+
+    // fall back to reading blocks
+    reader->data_size = READ_BLOCK_SIZE;
+    reader->data = (char *)malloc(reader->data_size);
+    if (!reader->data)
+    {
+        perror("open_reader: malloc error");
+        return -1;
+    }
+
+    reader->position = reader->data;
+    reader->end = reader->data;
+    return 0;
+}
+
+int start_pipeline(instruction_reader *reader)
+{
+    instruction_pipeline *pipeline = (instruction_pipeline *)aligned_alloc(CACHE_LINE_SIZE, sizeof(instruction_pipeline));
+    if (!pipeline)
+    {
+        perror("start_pipeline: aligned_alloc error");
+        return -1;
+    }
+
+    pipeline->head = 0;
+    pipeline->tail = 0;
+    pipeline->is_done = 0;
+    reader->pipeline = pipeline;
+
+    int error = pthread_create(&(pipeline->thread), NULL, decode_pipeline, reader);
+    if (error)
+    {
+        fprintf(stderr, "start_pipeline: pthread_create error: %s\n", strerror(error));
+        reader->pipeline = NULL;
+        free(pipeline);
+        return -1;
+    }
+
+    return 0;
+}
+
+int read_int(instruction_reader *reader, int *value)
+{
+    if (reader->next_value == reader->num_values)
+    {
+        if (reader->pipeline)
+        {
+            if (!next_pipeline_batch(reader))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            reader->num_values = fill_batch(reader, reader->values);
+            reader->next_value = 0;
+            if (!reader->num_values)
+            {
+                return 0;
+            }
+        }
+    }
+
+    *value = reader->batch[reader->next_value++];
+    return 1;
+}
+
+void close_reader(instruction_reader *reader)
+{
+    if (reader->pipeline)
+    {
+        // the reader thread stops once the end marker is in the ring,
+        // which may wait on slots that were never consumed
+        instruction_pipeline *pipeline = reader->pipeline;
+        while (!pipeline->is_done)
+        {
+            next_pipeline_batch(reader);
+        }
+        pthread_join(pipeline->thread, NULL);
+        free(pipeline);
+        reader->pipeline = NULL;
+    }
+
+    if (reader->is_mapped)
+    {
+        munmap(reader->data, reader->data_size);
+    }
+    else
+    {
+        free(reader->data);
+    }
+}
@@ -0,0 +1,74 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef INSTRUCTION_READER_H
+#define INSTRUCTION_READER_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define READ_BLOCK_SIZE (1 << 20)
+#define DECODE_BATCH_SIZE 4096
+// decoded batches the reader thread of a pipeline can run ahead by
+#define PIPELINE_NUM_SLOTS 16
+#define PIPELINE_SPIN_LIMIT 64
+#define CACHE_LINE_SIZE 64
+
+typedef struct
+{
+    int values[DECODE_BATCH_SIZE];
+    int num_values;
+} decoded_batch;
+
+// Single producer, single consumer ring of decoded batches. The reader
+// thread only writes head and the executing thread only writes tail, so
+// the two never need a lock. head and tail only ever grow, the slot of a
+// counter is taken modulo PIPELINE_NUM_SLOTS.
+typedef struct
+{
+    decoded_batch slots[PIPELINE_NUM_SLOTS];
+    // kept on their own cache lines so the threads do not fight over them
+    __attribute__((aligned(CACHE_LINE_SIZE))) unsigned int head;
+    __attribute__((aligned(CACHE_LINE_SIZE))) unsigned int tail;
+    // only read and written by the executing thread
+    int is_done;
+    pthread_t thread;
+} instruction_pipeline;
+
+// Reads whitespace separated integers from a file descriptor. Regular
+// files are mapped into memory, anything else (e.g. a pipe on stdin) is
+// read in large blocks. Integers are decoded in batches into values and
+// handed out one at a time by read_int.
+typedef struct
+{
+    int fd;
+    int is_mapped;
+    int is_eof;
+    // bytes that have not been decoded yet are in [position, end)
+    char *data;
+    size_t data_size;
+    const char *position;
+    const char *end;
+    int values[DECODE_BATCH_SIZE];
+    // batch being handed out, values or a slot of pipeline
+    const int *batch;
+    int num_values;
+    int next_value;
+    // set by start_pipeline, NULL if decoding runs on the calling thread
+    instruction_pipeline *pipeline;
+} instruction_reader;
+
+// returns 0 on success else -1
+int open_reader(instruction_reader *reader, int fd);
+// Moves decoding to a reader thread that runs ahead of read_int. Must be
+// called before the first read_int. Returns 0 on success else -1.
+int start_pipeline(instruction_reader *reader);
+// returns 1 and sets value if there is another integer else 0
+int read_int(instruction_reader *reader, int *value);
+void close_reader(instruction_reader *reader);
+
+#endif
@@ -5,33 +5,421 @@
 * Lab Group: 18
 *************************************/
 
+#include "function_pointers.h"
 #include "node.h"
 
 #include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// lists shorter than this are always traversed by a single thread
+#ifndef PARALLEL_THRESHOLD
+#define PARALLEL_THRESHOLD (1 << 16)
+#endif
+// a parallel traversal anchors every ANCHOR_SPACING-th node of a segment
+#ifndef ANCHOR_SPACING
+#define ANCHOR_SPACING 4096
+#endif
+#define MAX_THREADS 64
+// values handed to a batch function at once
+#define MAP_BATCH_SIZE 1024
+
+typedef struct
+{
+    node *anchor;
+    int length;
+} segment;
+
+// Work and partial results of one thread of a parallel traversal
+typedef struct
+{
+    list *lst;
+    int (*func)(int);
+    node **anchors;
+    int num_anchors;
+    // partial length, sum and bounds over the segments of this thread
+    int length;
+    long stored_sum;
+    int min_data;
+    int max_data;
+    // segments visited in order, including ones started by new anchors
+    segment *segments;
+    int num_segments;
+    int segment_capacity;
+} traversal_context;
+
+static int num_threads = 1;
+
 // Copy in your implementation of the functions from ex2.
 // There is one extra function called map which you have to fill up too.
 // Feel free to add any new functions as you deem fit.
-int get_list_length(list *lst)
+static int is_int(long value)
 {
-    if (!lst->head)
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+// Returns the value of a node after applying the pending transform
+static int get_data(list *lst, node *current_node)
+{
+    return (int)(lst->scale * current_node->data + lst->offset);
+}
+
+static void update_bounds(list *lst, int data)
+{
+    if (data < lst->min_data)
     {
-        return 0;
+        lst->min_data = data;
+    }
+    if (data > lst->max_data)
+    {
+        lst->max_data = data;
+    }
+}
+
+static node *create_node(int stored_data)
+{
+    node *new_node = (node *)malloc(sizeof(node));
+    new_node->data = stored_data;
+    new_node->is_anchor = 0;
+    return new_node;
+}
+
+static void add_anchor(list *lst, node *anchor)
+{
+    if (lst->num_anchors == lst->anchor_capacity)
+    {
+        lst->anchor_capacity = lst->anchor_capacity ? lst->anchor_capacity * 2 : 16;
+        lst->anchors = (node **)realloc(lst->anchors, lst->anchor_capacity * sizeof(node *));
     }
 
-    int length = 0;
-    node *current_node = lst->head;
+    anchor->is_anchor = 1;
+    lst->anchors[lst->num_anchors++] = anchor;
+}
+
+// Moves the anchor off a node that is about to be deleted, onto the next
+// node unless that one already starts a segment
+static void remove_anchor(list *lst, node *anchor)
+{
+    for (int i = 0; i < lst->num_anchors; i++)
+    {
+        if (lst->anchors[i] != anchor)
+        {
+            continue;
+        }
+
+        node *next_node = anchor->next;
+        if (next_node == anchor || next_node->is_anchor)
+        {
+            lst->anchors[i] = lst->anchors[--lst->num_anchors];
+        }
+        else
+        {
+            next_node->is_anchor = 1;
+            lst->anchors[i] = next_node;
+        }
+        return;
+    }
+}
+
+static void add_segment(traversal_context *traversal_ctx, node *anchor)
+{
+    if (traversal_ctx->num_segments == traversal_ctx->segment_capacity)
+    {
+        traversal_ctx->segment_capacity = traversal_ctx->segment_capacity ? traversal_ctx->segment_capacity * 2 : 16;
+        traversal_ctx->segments = (segment *)realloc(traversal_ctx->segments, traversal_ctx->segment_capacity * sizeof(segment));
+    }
+
+    traversal_ctx->segments[traversal_ctx->num_segments].anchor = anchor;
+    traversal_ctx->segments[traversal_ctx->num_segments].length = 0;
+    traversal_ctx->num_segments++;
+}
+
+// Thread body of a parallel materialize. Walks every segment assigned to
+// it and anchors every ANCHOR_SPACING-th node on the way, which only ever
+// touches nodes of its own segments.
+static void *materialize_segments(void *arg)
+{
+    traversal_context *traversal_ctx = (traversal_context *)arg;
+    list *lst = traversal_ctx->lst;
 
+    for (int i = 0; i < traversal_ctx->num_anchors; i++)
+    {
+        node *current_node = traversal_ctx->anchors[i];
+        int count = 0;
+        add_segment(traversal_ctx, current_node);
+
+        do
+        {
+            if (count == ANCHOR_SPACING)
+            {
+                current_node->is_anchor = 1;
+                add_segment(traversal_ctx, current_node);
+                count = 0;
+            }
+
+            int data = get_data(lst, current_node);
+            current_node->data = traversal_ctx->func ? traversal_ctx->func(data) : data;
+
+            if (current_node->data < traversal_ctx->min_data)
+            {
+                traversal_ctx->min_data = current_node->data;
+            }
+            if (current_node->data > traversal_ctx->max_data)
+            {
+                traversal_ctx->max_data = current_node->data;
+            }
+            traversal_ctx->length++;
+            traversal_ctx->stored_sum += current_node->data;
+            traversal_ctx->segments[traversal_ctx->num_segments - 1].length++;
+
+            count++;
+            current_node = current_node->next;
+        } while (!current_node->is_anchor);
+    }
+
+    return NULL;
+}
+
+// Replaces the anchors with one every ANCHOR_SPACING nodes from the head.
+// Only the next pointers are followed, so this is a lot cheaper than a
+// traversal that applies a function.
+static void seed_anchors(list *lst)
+{
+    for (int i = 0; i < lst->num_anchors; i++)
+    {
+        lst->anchors[i]->is_anchor = 0;
+    }
+    lst->num_anchors = 0;
+
+    node *current_node = lst->head;
+    int count = 0;
     do
     {
-        length++;
+        if (count++ % ANCHOR_SPACING == 0)
+        {
+            add_anchor(lst, current_node);
+        }
         current_node = current_node->next;
     } while (current_node != lst->head);
+}
+
+// Splits the anchors evenly among the threads, then reduces the partial
+// results and rebuilds the anchors from the segments that were visited.
+// Segments that shrank to under a quarter of the spacing are merged into
+// the one before them.
+static void materialize_parallel(list *lst, int (*func)(int))
+{
+    // a list that was built by inserts has few anchors if any, segments
+    // more than twice the spacing long on average are split up first
+    if (lst->num_anchors == 0 || lst->num_anchors < lst->length / ANCHOR_SPACING / 2)
+    {
+        seed_anchors(lst);
+    }
+
+    int num_workers = num_threads < lst->num_anchors ? num_threads : lst->num_anchors;
+    traversal_context traversal_ctxs[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        int first_anchor = (int)((long)i * lst->num_anchors / num_workers);
+        int last_anchor = (int)((long)(i + 1) * lst->num_anchors / num_workers);
+
+        traversal_ctxs[i].lst = lst;
+        traversal_ctxs[i].func = func;
+        traversal_ctxs[i].anchors = lst->anchors + first_anchor;
+        traversal_ctxs[i].num_anchors = last_anchor - first_anchor;
+        traversal_ctxs[i].length = 0;
+        traversal_ctxs[i].stored_sum = 0;
+        traversal_ctxs[i].min_data = INT_MAX;
+        traversal_ctxs[i].max_data = INT_MIN;
+        traversal_ctxs[i].segments = NULL;
+        traversal_ctxs[i].num_segments = 0;
+        traversal_ctxs[i].segment_capacity = 0;
+    }
+
+    // the calling thread takes the first share itself
+    for (int i = 1; i < num_workers; i++)
+    {
+        if (pthread_create(&threads[i], NULL, materialize_segments, &traversal_ctxs[i]) != 0)
+        {
+            perror("materialize_parallel: pthread_create error");
+            exit(1);
+        }
+    }
+    materialize_segments(&traversal_ctxs[0]);
+
+    // anchors may only change once every thread has stopped walking
+    for (int i = 1; i < num_workers; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    lst->length = 0;
+    lst->stored_sum = 0;
+    lst->min_data = INT_MAX;
+    lst->max_data = INT_MIN;
+    lst->num_anchors = 0;
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        traversal_context *traversal_ctx = &traversal_ctxs[i];
+        lst->length += traversal_ctx->length;
+        lst->stored_sum += traversal_ctx->stored_sum;
+        update_bounds(lst, traversal_ctx->min_data);
+        update_bounds(lst, traversal_ctx->max_data);
+
+        for (int j = 0; j < traversal_ctx->num_segments; j++)
+        {
+            segment *current_segment = &traversal_ctx->segments[j];
+
+            if (current_segment->length < ANCHOR_SPACING / 4 && (i > 0 || j > 0))
+            {
+                current_segment->anchor->is_anchor = 0;
+                continue;
+            }
+            add_anchor(lst, current_segment->anchor);
+        }
+
+        free(traversal_ctx->segments);
+    }
+
+    lst->scale = 1;
+    lst->offset = 0;
+}
+
+// Applies the pending transform followed by func (if any) to every node
+// and recomputes the length, sum and bounds in the same traversal
+static void materialize(list *lst, int (*func)(int))
+{
+    if (num_threads > 1 && lst->length >= PARALLEL_THRESHOLD)
+    {
+        materialize_parallel(lst, func);
+        return;
+    }
+
+    lst->min_data = INT_MAX;
+    lst->max_data = INT_MIN;
+    lst->length = 0;
+    lst->stored_sum = 0;
+
+    if (lst->head)
+    {
+        node *current_node = lst->head;
+        do
+        {
+            int data = get_data(lst, current_node);
+            current_node->data = func ? func(data) : data;
+
+            update_bounds(lst, current_node->data);
+            lst->length++;
+            lst->stored_sum += current_node->data;
+
+            current_node = current_node->next;
+        } while (current_node != lst->head);
+    }
+
+    lst->scale = 1;
+    lst->offset = 0;
+}
+
+// Composes x -> scale * x + offset onto the pending transform.
+// Returns 0 without changing the list if the result could overflow an int
+// for any node, in which case the map has to be applied eagerly.
+static int compose_transform(list *lst, long scale, long offset)
+{
+    if (!is_int(scale) || !is_int(offset))
+    {
+        return 0;
+    }
+
+    long new_scale = scale * lst->scale;
+    long new_offset = scale * lst->offset + offset;
+
+    if (!is_int(new_scale) || !is_int(new_offset))
+    {
+        return 0;
+    }
+
+    // bounds are empty if the list has no nodes
+    if (lst->min_data <= lst->max_data &&
+        (!is_int(new_scale * lst->min_data + new_offset) ||
+         !is_int(new_scale * lst->max_data + new_offset)))
+    {
+        return 0;
+    }
+
+    lst->scale = new_scale;
+    lst->offset = new_offset;
+    return 1;
+}
+
+// Returns 1 if data can be stored under the pending transform
+static int is_storable(list *lst, int data)
+{
+    long difference = data - lst->offset;
+    return difference % lst->scale == 0 && is_int(difference / lst->scale);
+}
+
+// Returns the value to store for data under the pending transform.
+// The transform is applied to every node first if data cannot be
+// stored under it.
+static int get_stored_data(list *lst, int data)
+{
+    if (!is_storable(lst, data))
+    {
+        materialize(lst, NULL);
+    }
+
+    int stored_data = (int)((data - lst->offset) / lst->scale);
+    update_bounds(lst, stored_data);
+    return stored_data;
+}
 
-    return length;
+// Empties lst without touching its lookup counters
+static void clear_list(list *lst)
+{
+    lst->head = NULL;
+    lst->scale = 1;
+    lst->offset = 0;
+    lst->min_data = INT_MAX;
+    lst->max_data = INT_MIN;
+    lst->length = 0;
+    lst->stored_sum = 0;
+    lst->anchors = NULL;
+    lst->num_anchors = 0;
+    lst->anchor_capacity = 0;
+}
+
+void init_list(list *lst)
+{
+    clear_list(lst);
+    lst->num_lookups = 0;
+    lst->num_hops = 0;
+}
+
+void set_num_threads(int new_num_threads)
+{
+    if (new_num_threads < 1)
+    {
+        new_num_threads = 1;
+    }
+    num_threads = new_num_threads < MAX_THREADS ? new_num_threads : MAX_THREADS;
+}
+
+int get_list_length(list *lst)
+{
+    return lst->length;
+}
+
+void get_list_stats(list *lst, list_stats *stats)
+{
+    stats->length = lst->length;
+    stats->num_lookups = lst->num_lookups;
+    stats->num_hops = lst->num_hops;
 }
 
 node *get_node_at(list *lst, int index)
@@ -45,6 +433,8 @@ node *get_node_at(list *lst, int index)
         current_node = current_node->next;
     }
 
+    lst->num_lookups++;
+    lst->num_hops += current_index;
     return current_node;
 }
 
@@ -53,8 +443,7 @@ node *get_node_at(list *lst, int index)
 // Note: index is guaranteed to be valid.
 void insert_node_at(list *lst, int index, int data)
 {
-    node *new_node = (node *)malloc(sizeof(node));
-    new_node->data = data;
+    node *new_node = create_node(get_stored_data(lst, data));
 
     // case 1: node is inserted at the head
     // need to update head and tail pointer
@@ -74,6 +463,8 @@ void insert_node_at(list *lst, int index, int data)
             tail_node->next = lst->head;
         }
 
+        lst->length++;
+        lst->stored_sum += new_node->data;
         return;
     }
 
@@ -81,6 +472,64 @@ void insert_node_at(list *lst, int index, int data)
     node *previous_node = get_node_at(lst, index - 1);
     new_node->next = previous_node->next;
     previous_node->next = new_node;
+
+    lst->length++;
+    lst->stored_sum += new_node->data;
+}
+
+// Inserts num_values new nodes with the given data values, the first
+// one at index. The new nodes are linked into a chain first so that the
+// list is only walked once.
+// Note: index is guaranteed to be valid.
+void insert_range_at(list *lst, int index, const int *values, int num_values)
+{
+    if (num_values <= 0)
+    {
+        return;
+    }
+
+    // the chain is stored under a single transform, so flush it up front
+    // if any value cannot be stored under it
+    for (int i = 0; i < num_values; i++)
+    {
+        if (!is_storable(lst, values[i]))
+        {
+            materialize(lst, NULL);
+            break;
+        }
+    }
+
+    node *first_node = create_node(get_stored_data(lst, values[0]));
+    node *last_node = first_node;
+    long chain_sum = first_node->data;
+
+    for (int i = 1; i < num_values; i++)
+    {
+        last_node->next = create_node(get_stored_data(lst, values[i]));
+        last_node = last_node->next;
+        chain_sum += last_node->data;
+    }
+
+    if (!lst->head)
+    {
+        last_node->next = first_node;
+        lst->head = first_node;
+    }
+    else
+    {
+        // the node before the head is the tail
+        node *previous_node = get_node_at(lst, index == 0 ? get_list_length(lst) - 1 : index - 1);
+        last_node->next = previous_node->next;
+        previous_node->next = first_node;
+
+        if (index == 0)
+        {
+            lst->head = first_node;
+        }
+    }
+
+    lst->length += num_values;
+    lst->stored_sum += chain_sum;
 }
 
 // Deletes node at index (counting from head starting from 0).
@@ -91,6 +540,10 @@ void delete_node_at(list *lst, int index)
     if (index == 0)
     {
         node *old_head = lst->head;
+        if (old_head->is_anchor)
+        {
+            remove_anchor(lst, old_head);
+        }
         int length = get_list_length(lst);
 
         if (length == 1)
@@ -105,6 +558,8 @@ void delete_node_at(list *lst, int index)
         }
 
         // clean up
+        lst->length--;
+        lst->stored_sum -= old_head->data;
         free(old_head);
 
         return;
@@ -113,12 +568,123 @@ void delete_node_at(list *lst, int index)
     // case 2: node is removed elsewhere
     node *previous_node = get_node_at(lst, index - 1);
     node *to_remove_node = previous_node->next;
+    if (to_remove_node->is_anchor)
+    {
+        remove_anchor(lst, to_remove_node);
+    }
     previous_node->next = to_remove_node->next;
 
     // clean up
+    lst->length--;
+    lst->stored_sum -= to_remove_node->data;
     free(to_remove_node);
 }
 
+// Deletes the count nodes starting at index with a single walk to the
+// node before them.
+// Note: index and count are guaranteed to be valid.
+void delete_range(list *lst, int index, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // anchors could otherwise be moved onto nodes that are already freed
+    if (count == get_list_length(lst))
+    {
+        reset_list(lst);
+        return;
+    }
+
+    // the node before the head is the tail
+    node *previous_node = get_node_at(lst, index == 0 ? get_list_length(lst) - 1 : index - 1);
+    node *current_node = previous_node->next;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (current_node->is_anchor)
+        {
+            remove_anchor(lst, current_node);
+        }
+
+        node *next_node = current_node->next;
+        lst->stored_sum -= current_node->data;
+        free(current_node);
+        current_node = next_node;
+    }
+
+    previous_node->next = current_node;
+    if (index == 0)
+    {
+        lst->head = current_node;
+    }
+
+    lst->length -= count;
+}
+
+// Links the nodes of other in at index with a single walk. Their values
+// are stored again under the pending transform of lst, and the anchors
+// of other become anchors of lst.
+// Note: index is guaranteed to be valid.
+void splice_list(list *lst, list *other, int index)
+{
+    if (!other->head)
+    {
+        return;
+    }
+
+    node *current_node = other->head;
+    do
+    {
+        if (!is_storable(lst, get_data(other, current_node)))
+        {
+            materialize(lst, NULL);
+            break;
+        }
+        current_node = current_node->next;
+    } while (current_node != other->head);
+
+    node *last_node = NULL;
+    long chain_sum = 0;
+    current_node = other->head;
+    do
+    {
+        current_node->data = get_stored_data(lst, get_data(other, current_node));
+        chain_sum += current_node->data;
+        last_node = current_node;
+        current_node = current_node->next;
+    } while (current_node != other->head);
+
+    if (!lst->head)
+    {
+        lst->head = other->head;
+    }
+    else
+    {
+        // the node before the head is the tail
+        node *previous_node = get_node_at(lst, index == 0 ? get_list_length(lst) - 1 : index - 1);
+        last_node->next = previous_node->next;
+        previous_node->next = other->head;
+
+        if (index == 0)
+        {
+            lst->head = other->head;
+        }
+    }
+
+    for (int i = 0; i < other->num_anchors; i++)
+    {
+        add_anchor(lst, other->anchors[i]);
+    }
+
+    lst->length += other->length;
+    lst->stored_sum += chain_sum;
+
+    free(other->anchors);
+    clear_list(other);
+}
+
 // Rotates list by the given offset.
 // Note: offset is guarenteed to be non-negative.
 void rotate_list(list *lst, int offset)
@@ -184,6 +750,8 @@ void reset_list(list *lst)
     // approach 2 O(n): single pass
     if (!lst->head)
     {
+        free(lst->anchors);
+        clear_list(lst);
         return;
     }
 
@@ -196,11 +764,13 @@ void reset_list(list *lst)
     }
 
     free(lst->head);
-    lst->head = NULL;
+    free(lst->anchors);
+    clear_list(lst);
 }
 
-// Traverses list and applies func on data values of
-// all elements in the list.
+// Applies func on data values of all elements in the list.
+// Affine functions are composed into the pending transform in O(1),
+// any other function is applied with a single traversal.
 void map(list *lst, int (*func)(int))
 {
     if (!lst->head)
@@ -208,30 +778,65 @@ void map(list *lst, int (*func)(int))
         return;
     }
 
-    node *current_node = lst->head;
-    do
+    long scale, offset;
+    if (get_affine_coefficients(func, &scale, &offset) && compose_transform(lst, scale, offset))
     {
-        current_node->data = func(current_node->data);
-        current_node = current_node->next;
-    } while (current_node != lst->head);
+        return;
+    }
+
+    materialize(lst, func);
 }
 
-// Traverses list and returns the sum of the data values
-// of every node in the list.
-long sum_list(list *lst)
+// Applies the pending transform to every node, gathering the values of
+// MAP_BATCH_SIZE nodes at a time for batch_func and storing the results
+// back. Length, sum and bounds are recomputed on the way.
+void map_batch(list *lst, void (*batch_func)(int *values, size_t num_values))
 {
     if (!lst->head)
     {
-        return 0;
+        return;
     }
 
-    long sum = 0;
+    int values[MAP_BATCH_SIZE];
+    node *nodes[MAP_BATCH_SIZE];
     node *current_node = lst->head;
+
+    lst->min_data = INT_MAX;
+    lst->max_data = INT_MIN;
+    lst->length = 0;
+    lst->stored_sum = 0;
+
     do
     {
-        sum += current_node->data;
-        current_node = current_node->next;
+        int num_values = 0;
+        do
+        {
+            nodes[num_values] = current_node;
+            values[num_values++] = get_data(lst, current_node);
+            current_node = current_node->next;
+        } while (num_values < MAP_BATCH_SIZE && current_node != lst->head);
+
+        batch_func(values, num_values);
+
+        for (int i = 0; i < num_values; i++)
+        {
+            nodes[i]->data = values[i];
+            update_bounds(lst, values[i]);
+            lst->stored_sum += values[i];
+        }
+        lst->length += num_values;
     } while (current_node != lst->head);
 
-    return sum;
+    lst->scale = 1;
+    lst->offset = 0;
+}
+
+// Returns the sum of the data values of every node in the list in O(1)
+// from the running sum of the stored values.
+long sum_list(list *lst)
+{
+    // wraps around like the per node sum would if any intermediate
+    // product overflows, the final sum always fits in a long
+    return (long)((unsigned long)lst->scale * (unsigned long)lst->stored_sum +
+                  (unsigned long)lst->offset * (unsigned long)lst->length);
 }
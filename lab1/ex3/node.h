@@ -4,19 +4,89 @@
     during grading so any changes in this file will be overwritten
 */
 
+#ifndef NODE_H
+#define NODE_H
+
+#include <stddef.h>
+
+#ifdef UNROLLED_LIST
+#ifndef CHUNK_CAPACITY
+#define CHUNK_CAPACITY 64
+#endif
+
+// Unrolled circular list: every chunk stores up to CHUNK_CAPACITY
+// consecutive data values so that map and sum_list run over arrays
+typedef struct CHUNK {
+    int values[CHUNK_CAPACITY];
+    int num_values;
+    struct CHUNK *next;
+} chunk;
+
+typedef struct {
+    chunk *head;
+    chunk *tail;
+    int length;
+    // lookups by index and chunks walked by them, kept across resets
+    long num_lookups;
+    long num_hops;
+} list;
+#else
 typedef struct NODE {
     int data;
+    // 1 if a segment of a parallel traversal starts here
+    int is_anchor;
     struct NODE *next;
 } node;
 
 typedef struct {
     node *head;
+    // pending affine transform, the value of a node is
+    // scale * data + offset
+    long scale;
+    long offset;
+    // bounds on the stored data values, may be looser than the
+    // actual ones after deletions
+    int min_data;
+    int max_data;
+    // number of nodes and running sum of stored data values
+    int length;
+    long stored_sum;
+    // nodes with is_anchor set, in no particular order. Each one starts
+    // a segment that runs up to the next anchor in the ring.
+    node **anchors;
+    int num_anchors;
+    int anchor_capacity;
+    // calls to get_node_at and nodes walked by them, kept across resets
+    long num_lookups;
+    long num_hops;
 } list;
+#endif
+
+// Gauges on the shape of a list, read by the profiler
+typedef struct {
+    int length;
+    long num_lookups;
+    long num_hops;
+} list_stats;
 
+void init_list(list *lst);
 void insert_node_at(list *lst, int index, int data);
+void insert_range_at(list *lst, int index, const int *values, int num_values);
 void delete_node_at(list *lst, int index);
+// Deletes the count nodes starting at index
+void delete_range(list *lst, int index, int count);
+// Moves every node of other into lst, the first one at index, and leaves
+// other empty
+void splice_list(list *lst, list *other, int index);
 void rotate_list(list *lst, int offset);
 void reverse_list(list *lst);
 void reset_list(list *lst);
 void map(list *lst, int (*func)(int));
+// Applies batch_func to consecutive runs of data values in place
+void map_batch(list *lst, void (*batch_func)(int *values, size_t num_values));
 long sum_list(list *list);
+// Sets the number of threads used to traverse large lists (default 1)
+void set_num_threads(int num_threads);
+void get_list_stats(list *lst, list_stats *stats);
+
+#endif
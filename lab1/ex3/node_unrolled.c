@@ -0,0 +1,680 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Unrolled implementation of the circular list (compile with
+// -DUNROLLED_LIST). Values live in fixed size chunks, so map and sum_list
+// run as vectorised loops over each chunk. The AVX2 or SSE4.1 kernels are
+// picked at runtime and fall back to scalar loops on other CPUs.
+
+#include "function_pointers.h"
+#include "node.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS 1
+#endif
+
+// chunks are merged with their successor once they fit in half a chunk
+#define MERGE_THRESHOLD (CHUNK_CAPACITY / 2)
+
+static void (*map_affine_kernel)(int *values, int num_values, int scale, int offset);
+static void (*map_power_kernel)(int *values, int num_values, int exponent);
+static long (*sum_kernel)(const int *values, int num_values);
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+// Scalar kernels, arithmetic is done on unsigned ints so that overflow
+// wraps around the same way the vector kernels do
+static void map_affine_scalar(int *values, int num_values, int scale, int offset)
+{
+    for (int i = 0; i < num_values; i++)
+    {
+        values[i] = (int)((unsigned int)scale * (unsigned int)values[i] + (unsigned int)offset);
+    }
+}
+
+static void map_power_scalar(int *values, int num_values, int exponent)
+{
+    for (int i = 0; i < num_values; i++)
+    {
+        unsigned int value = (unsigned int)values[i];
+        unsigned int result = value;
+        for (int j = 1; j < exponent; j++)
+        {
+            result *= value;
+        }
+        values[i] = (int)result;
+    }
+}
+
+static long sum_scalar(const int *values, int num_values)
+{
+    long sum = 0;
+    for (int i = 0; i < num_values; i++)
+    {
+        sum += values[i];
+    }
+    return sum;
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("avx2"))) static void map_affine_avx2(int *values, int num_values, int scale, int offset)
+{
+    __m256i scale_vector = _mm256_set1_epi32(scale);
+    __m256i offset_vector = _mm256_set1_epi32(offset);
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        __m256i vector = _mm256_loadu_si256((__m256i *)(values + i));
+        vector = _mm256_add_epi32(_mm256_mullo_epi32(vector, scale_vector), offset_vector);
+        _mm256_storeu_si256((__m256i *)(values + i), vector);
+    }
+
+    map_affine_scalar(values + i, num_values - i, scale, offset);
+}
+
+__attribute__((target("avx2"))) static void map_power_avx2(int *values, int num_values, int exponent)
+{
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        __m256i vector = _mm256_loadu_si256((__m256i *)(values + i));
+        __m256i result = vector;
+        for (int j = 1; j < exponent; j++)
+        {
+            result = _mm256_mullo_epi32(result, vector);
+        }
+        _mm256_storeu_si256((__m256i *)(values + i), result);
+    }
+
+    map_power_scalar(values + i, num_values - i, exponent);
+}
+
+__attribute__((target("avx2"))) static long sum_avx2(const int *values, int num_values)
+{
+    // accumulates in 64-bit lanes so that the sum cannot overflow
+    __m256i total = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        __m256i vector = _mm256_loadu_si256((const __m256i *)(values + i));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(vector)));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(vector, 1)));
+    }
+
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(values + i, num_values - i);
+}
+
+__attribute__((target("sse4.1"))) static void map_affine_sse(int *values, int num_values, int scale, int offset)
+{
+    __m128i scale_vector = _mm_set1_epi32(scale);
+    __m128i offset_vector = _mm_set1_epi32(offset);
+    int i = 0;
+
+    for (; i + 4 <= num_values; i += 4)
+    {
+        __m128i vector = _mm_loadu_si128((__m128i *)(values + i));
+        vector = _mm_add_epi32(_mm_mullo_epi32(vector, scale_vector), offset_vector);
+        _mm_storeu_si128((__m128i *)(values + i), vector);
+    }
+
+    map_affine_scalar(values + i, num_values - i, scale, offset);
+}
+
+__attribute__((target("sse4.1"))) static void map_power_sse(int *values, int num_values, int exponent)
+{
+    int i = 0;
+
+    for (; i + 4 <= num_values; i += 4)
+    {
+        __m128i vector = _mm_loadu_si128((__m128i *)(values + i));
+        __m128i result = vector;
+        for (int j = 1; j < exponent; j++)
+        {
+            result = _mm_mullo_epi32(result, vector);
+        }
+        _mm_storeu_si128((__m128i *)(values + i), result);
+    }
+
+    map_power_scalar(values + i, num_values - i, exponent);
+}
+
+__attribute__((target("sse4.1"))) static long sum_sse(const int *values, int num_values)
+{
+    __m128i total = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 4 <= num_values; i += 4)
+    {
+        __m128i vector = _mm_loadu_si128((const __m128i *)(values + i));
+        total = _mm_add_epi64(total, _mm_cvtepi32_epi64(vector));
+        total = _mm_add_epi64(total, _mm_cvtepi32_epi64(_mm_srli_si128(vector, 8)));
+    }
+
+    long long lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, total);
+
+    return lanes[0] + lanes[1] + sum_scalar(values + i, num_values - i);
+}
+#endif
+
+// Picks the widest kernels supported by the CPU, only done once
+static void select_kernels()
+{
+    map_affine_kernel = map_affine_scalar;
+    map_power_kernel = map_power_scalar;
+    sum_kernel = sum_scalar;
+
+#ifdef HAS_X86_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+    {
+        map_affine_kernel = map_affine_avx2;
+        map_power_kernel = map_power_avx2;
+        sum_kernel = sum_avx2;
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+        map_affine_kernel = map_affine_sse;
+        map_power_kernel = map_power_sse;
+        sum_kernel = sum_sse;
+    }
+#endif
+}
+
+static chunk *create_chunk()
+{
+    chunk *new_chunk = (chunk *)malloc(sizeof(chunk));
+    new_chunk->num_values = 0;
+    new_chunk->next = new_chunk;
+    return new_chunk;
+}
+
+// Returns the chunk containing index and sets index to the position
+// within that chunk. If is_inserting is 1, an index at the end of a chunk
+// stays in that chunk so that appending to the tail works.
+static chunk *find_chunk(list *lst, int *index, int is_inserting, chunk **previous_chunk)
+{
+    chunk *previous = lst->tail;
+    chunk *current = lst->head;
+
+    lst->num_lookups++;
+    while (*index > current->num_values || (*index == current->num_values && !is_inserting))
+    {
+        *index -= current->num_values;
+        previous = current;
+        current = current->next;
+        lst->num_hops++;
+    }
+
+    *previous_chunk = previous;
+    return current;
+}
+
+// Moves all values from position count onwards into a new chunk
+// right after current_chunk
+static void split_chunk(list *lst, chunk *current_chunk, int count)
+{
+    chunk *new_chunk = create_chunk();
+    new_chunk->num_values = current_chunk->num_values - count;
+    memcpy(new_chunk->values, current_chunk->values + count, new_chunk->num_values * sizeof(int));
+
+    current_chunk->num_values = count;
+    new_chunk->next = current_chunk->next;
+    current_chunk->next = new_chunk;
+
+    if (lst->tail == current_chunk)
+    {
+        lst->tail = new_chunk;
+    }
+}
+
+// Merges the successor of current_chunk into it if both are sparse
+static void try_merge_next(list *lst, chunk *current_chunk)
+{
+    chunk *next_chunk = current_chunk->next;
+
+    if (current_chunk == lst->tail || current_chunk->num_values + next_chunk->num_values > MERGE_THRESHOLD)
+    {
+        return;
+    }
+
+    memcpy(current_chunk->values + current_chunk->num_values, next_chunk->values, next_chunk->num_values * sizeof(int));
+    current_chunk->num_values += next_chunk->num_values;
+    current_chunk->next = next_chunk->next;
+
+    if (lst->tail == next_chunk)
+    {
+        lst->tail = current_chunk;
+    }
+
+    free(next_chunk);
+}
+
+static void remove_chunk(list *lst, chunk *current_chunk, chunk *previous_chunk)
+{
+    if (current_chunk->next == current_chunk)
+    {
+        lst->head = NULL;
+        lst->tail = NULL;
+    }
+    else
+    {
+        previous_chunk->next = current_chunk->next;
+
+        if (lst->head == current_chunk)
+        {
+            lst->head = current_chunk->next;
+        }
+        if (lst->tail == current_chunk)
+        {
+            lst->tail = previous_chunk;
+        }
+    }
+
+    free(current_chunk);
+}
+
+void init_list(list *lst)
+{
+    // lists may be created by several threads at once
+    pthread_once(&kernels_once, select_kernels);
+
+    lst->head = NULL;
+    lst->tail = NULL;
+    lst->length = 0;
+    lst->num_lookups = 0;
+    lst->num_hops = 0;
+}
+
+void get_list_stats(list *lst, list_stats *stats)
+{
+    stats->length = lst->length;
+    stats->num_lookups = lst->num_lookups;
+    stats->num_hops = lst->num_hops;
+}
+
+// Chunks are processed with vector kernels on a single thread, so the
+// thread count is ignored.
+void set_num_threads(int num_threads)
+{
+    (void)num_threads;
+}
+
+// Inserts a new node with data value at index (counting from head
+// starting at 0).
+// Note: index is guaranteed to be valid.
+void insert_node_at(list *lst, int index, int data)
+{
+    if (!lst->head)
+    {
+        lst->head = create_chunk();
+        lst->tail = lst->head;
+    }
+
+    chunk *previous_chunk;
+    chunk *current_chunk = find_chunk(lst, &index, 1, &previous_chunk);
+
+    if (current_chunk->num_values == CHUNK_CAPACITY)
+    {
+        split_chunk(lst, current_chunk, CHUNK_CAPACITY / 2);
+
+        if (index > current_chunk->num_values)
+        {
+            index -= current_chunk->num_values;
+            current_chunk = current_chunk->next;
+        }
+    }
+
+    memmove(current_chunk->values + index + 1,
+            current_chunk->values + index,
+            (current_chunk->num_values - index) * sizeof(int));
+    current_chunk->values[index] = data;
+    current_chunk->num_values++;
+    lst->length++;
+}
+
+// Inserts num_values new nodes with the given data values, the first
+// one at index. The chunk at index is split once and the values are
+// copied into it and into new chunks linked right after it.
+// Note: index is guaranteed to be valid.
+void insert_range_at(list *lst, int index, const int *values, int num_values)
+{
+    if (num_values <= 0)
+    {
+        return;
+    }
+
+    if (!lst->head)
+    {
+        lst->head = create_chunk();
+        lst->tail = lst->head;
+    }
+
+    chunk *previous_chunk;
+    chunk *current_chunk = find_chunk(lst, &index, 1, &previous_chunk);
+
+    if (index < current_chunk->num_values)
+    {
+        split_chunk(lst, current_chunk, index);
+    }
+
+    lst->length += num_values;
+
+    while (num_values > 0)
+    {
+        if (current_chunk->num_values == CHUNK_CAPACITY)
+        {
+            chunk *new_chunk = create_chunk();
+            new_chunk->next = current_chunk->next;
+            current_chunk->next = new_chunk;
+
+            if (lst->tail == current_chunk)
+            {
+                lst->tail = new_chunk;
+            }
+            current_chunk = new_chunk;
+        }
+
+        int count = CHUNK_CAPACITY - current_chunk->num_values;
+        if (count > num_values)
+        {
+            count = num_values;
+        }
+
+        memcpy(current_chunk->values + current_chunk->num_values, values, count * sizeof(int));
+        current_chunk->num_values += count;
+        values += count;
+        num_values -= count;
+    }
+}
+
+// Deletes node at index (counting from head starting from 0).
+// Note: index is guarenteed to be valid.
+void delete_node_at(list *lst, int index)
+{
+    chunk *previous_chunk;
+    chunk *current_chunk = find_chunk(lst, &index, 0, &previous_chunk);
+
+    memmove(current_chunk->values + index,
+            current_chunk->values + index + 1,
+            (current_chunk->num_values - index - 1) * sizeof(int));
+    current_chunk->num_values--;
+    lst->length--;
+
+    if (current_chunk->num_values == 0)
+    {
+        remove_chunk(lst, current_chunk, previous_chunk);
+        return;
+    }
+
+    try_merge_next(lst, current_chunk);
+}
+
+// Deletes the count values starting at index. Chunks in the middle of the
+// range are dropped whole, only the first and last one are compacted.
+// Note: index and count are guaranteed to be valid.
+void delete_range(list *lst, int index, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    if (count == lst->length)
+    {
+        reset_list(lst);
+        return;
+    }
+
+    chunk *previous_chunk;
+    chunk *current_chunk = find_chunk(lst, &index, 0, &previous_chunk);
+    lst->length -= count;
+
+    while (count > 0)
+    {
+        int num_removed = current_chunk->num_values - index;
+        if (num_removed > count)
+        {
+            num_removed = count;
+        }
+
+        memmove(current_chunk->values + index,
+                current_chunk->values + index + num_removed,
+                (current_chunk->num_values - index - num_removed) * sizeof(int));
+        current_chunk->num_values -= num_removed;
+        count -= num_removed;
+
+        chunk *next_chunk = current_chunk->next;
+        if (current_chunk->num_values == 0)
+        {
+            remove_chunk(lst, current_chunk, previous_chunk);
+        }
+        else
+        {
+            previous_chunk = current_chunk;
+        }
+
+        current_chunk = next_chunk;
+        index = 0;
+    }
+
+    // the chunks on both sides of the range are now adjacent
+    try_merge_next(lst, previous_chunk);
+}
+
+// Links the chunks of other in at index, splitting at most one chunk.
+// Note: index is guaranteed to be valid.
+void splice_list(list *lst, list *other, int index)
+{
+    if (!other->head)
+    {
+        return;
+    }
+
+    if (!lst->head)
+    {
+        lst->head = other->head;
+        lst->tail = other->tail;
+    }
+    else if (index == 0)
+    {
+        lst->tail->next = other->head;
+        other->tail->next = lst->head;
+        lst->head = other->head;
+        try_merge_next(lst, other->tail);
+    }
+    else
+    {
+        chunk *previous_chunk;
+        chunk *current_chunk = find_chunk(lst, &index, 1, &previous_chunk);
+
+        if (index < current_chunk->num_values)
+        {
+            split_chunk(lst, current_chunk, index);
+        }
+
+        other->tail->next = current_chunk->next;
+        current_chunk->next = other->head;
+        if (lst->tail == current_chunk)
+        {
+            lst->tail = other->tail;
+        }
+
+        try_merge_next(lst, other->tail);
+        try_merge_next(lst, current_chunk);
+    }
+
+    lst->length += other->length;
+
+    other->head = NULL;
+    other->tail = NULL;
+    other->length = 0;
+}
+
+// Rotates list by the given offset, splitting at most one chunk.
+// Note: offset is guarenteed to be non-negative.
+void rotate_list(list *lst, int offset)
+{
+    if (lst->length <= 1 || offset % lst->length == 0)
+    {
+        return;
+    }
+
+    offset = offset % lst->length;
+    chunk *old_tail = lst->tail;
+    chunk *previous_chunk;
+    chunk *current_chunk = find_chunk(lst, &offset, 0, &previous_chunk);
+
+    if (offset > 0)
+    {
+        split_chunk(lst, current_chunk, offset);
+        previous_chunk = current_chunk;
+        current_chunk = current_chunk->next;
+    }
+
+    lst->head = current_chunk;
+    lst->tail = previous_chunk;
+
+    // old tail and old head are now adjacent
+    try_merge_next(lst, old_tail);
+}
+
+// Reverses the list, with the original "tail" node
+// becoming the new head node.
+void reverse_list(list *lst)
+{
+    if (!lst->head)
+    {
+        return;
+    }
+
+    chunk *current_chunk = lst->head;
+    chunk *previous_chunk = lst->tail;
+    chunk *next_chunk;
+
+    do
+    {
+        for (int i = 0, j = current_chunk->num_values - 1; i < j; i++, j--)
+        {
+            int temp = current_chunk->values[i];
+            current_chunk->values[i] = current_chunk->values[j];
+            current_chunk->values[j] = temp;
+        }
+
+        next_chunk = current_chunk->next;
+        current_chunk->next = previous_chunk;
+        previous_chunk = current_chunk;
+        current_chunk = next_chunk;
+    } while (current_chunk != lst->head);
+
+    lst->head = lst->tail;
+    lst->tail = current_chunk;
+}
+
+// Resets list to an empty state (no nodes) and frees
+// any allocated memory in the process
+void reset_list(list *lst)
+{
+    if (lst->head)
+    {
+        lst->tail->next = NULL;
+    }
+
+    chunk *current_chunk = lst->head;
+    while (current_chunk)
+    {
+        chunk *next_chunk = current_chunk->next;
+        free(current_chunk);
+        current_chunk = next_chunk;
+    }
+
+    lst->head = NULL;
+    lst->tail = NULL;
+    lst->length = 0;
+}
+
+// Applies func on data values of all elements in the list. The functions
+// in func_list run as vector kernels, anything else is called per value.
+void map(list *lst, int (*func)(int))
+{
+    if (!lst->head)
+    {
+        return;
+    }
+
+    long scale, offset;
+    int is_affine = get_affine_coefficients(func, &scale, &offset);
+    int exponent = get_power_exponent(func);
+    chunk *current_chunk = lst->head;
+
+    do
+    {
+        if (is_affine)
+        {
+            map_affine_kernel(current_chunk->values, current_chunk->num_values, (int)scale, (int)offset);
+        }
+        else if (exponent)
+        {
+            map_power_kernel(current_chunk->values, current_chunk->num_values, exponent);
+        }
+        else
+        {
+            for (int i = 0; i < current_chunk->num_values; i++)
+            {
+                current_chunk->values[i] = func(current_chunk->values[i]);
+            }
+        }
+
+        current_chunk = current_chunk->next;
+    } while (current_chunk != lst->head);
+}
+
+// Hands the values of every chunk to batch_func as they are stored.
+void map_batch(list *lst, void (*batch_func)(int *values, size_t num_values))
+{
+    if (!lst->head)
+    {
+        return;
+    }
+
+    chunk *current_chunk = lst->head;
+    do
+    {
+        batch_func(current_chunk->values, current_chunk->num_values);
+        current_chunk = current_chunk->next;
+    } while (current_chunk != lst->head);
+}
+
+// Returns the sum of the data values of every node in the list.
+long sum_list(list *lst)
+{
+    if (!lst->head)
+    {
+        return 0;
+    }
+
+    long sum = 0;
+    chunk *current_chunk = lst->head;
+
+    do
+    {
+        sum += sum_kernel(current_chunk->values, current_chunk->num_values);
+        current_chunk = current_chunk->next;
+    } while (current_chunk != lst->head);
+
+    return sum;
+}
@@ -0,0 +1,28 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Example batch transforms for ex3 --plugin plugin_example.so:<symbol>.
+// Plain loops over contiguous values, which the compiler vectorises.
+
+#include <stddef.h>
+
+void negate(int *values, size_t num_values)
+{
+    for (size_t i = 0; i < num_values; i++)
+    {
+        // through unsigned so that INT_MIN wraps instead of overflowing
+        values[i] = (int)(0U - (unsigned int)values[i]);
+    }
+}
+
+void halve(int *values, size_t num_values)
+{
+    for (size_t i = 0; i < num_values; i++)
+    {
+        values[i] /= 2;
+    }
+}
@@ -0,0 +1,208 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Cycle counter on x86, monotonic clock in nanoseconds elsewhere
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICK_UNIT "cycles"
+
+static unsigned long long read_ticks()
+{
+    return __rdtsc();
+}
+#else
+#define TICK_UNIT "ns"
+
+static unsigned long long read_ticks()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+
+static const char *opcode_names[NUM_PROFILED_OPCODES] = {
+    [SUM_LIST] = "SUM_LIST",
+    [INSERT_AT] = "INSERT_AT",
+    [DELETE_AT] = "DELETE_AT",
+    [ROTATE_LIST] = "ROTATE_LIST",
+    [REVERSE_LIST] = "REVERSE_LIST",
+    [RESET_LIST] = "RESET_LIST",
+    [MAP] = "MAP",
+    [INSERT_RANGE] = "INSERT_RANGE",
+    [DELETE_RANGE] = "DELETE_RANGE",
+    [SPLICE] = "SPLICE",
+    [SPLICE + 1] = "UNKNOWN",
+};
+
+static int get_bucket(unsigned long long ticks)
+{
+    return ticks ? 64 - __builtin_clzll(ticks) : 0;
+}
+
+// Exclusive upper bound of the bucket
+static unsigned long long get_bucket_limit(int bucket)
+{
+    return bucket >= 64 ? ~0ULL : 1ULL << bucket;
+}
+
+// Upper bound on the latency below which the given permille of the
+// instructions fall
+static unsigned long long get_percentile(opcode_profile *opcode, int permille)
+{
+    long target = (opcode->count * permille + 999) / 1000;
+    long seen = 0;
+
+    for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+    {
+        seen += opcode->histogram[bucket];
+        if (seen >= target)
+        {
+            return get_bucket_limit(bucket);
+        }
+    }
+
+    return opcode->max_ticks;
+}
+
+static double get_average(long total, long count)
+{
+    return count ? (double)total / count : 0;
+}
+
+void init_profiler(profiler *prof, int format)
+{
+    memset(prof, 0, sizeof(profiler));
+    prof->format = format;
+}
+
+void profile_instruction(profiler *prof, list *lst, int instr, instruction_reader *reader)
+{
+    list_stats before, after;
+    get_list_stats(lst, &before);
+
+    unsigned long long start = read_ticks();
+    run_instruction(lst, instr, reader);
+    unsigned long long ticks = read_ticks() - start;
+
+    get_list_stats(lst, &after);
+
+    opcode_profile *opcode = &(prof->opcodes[instr >= 0 && instr <= SPLICE ? instr : SPLICE + 1]);
+    opcode->count++;
+    opcode->total_ticks += ticks;
+    opcode->max_ticks = ticks > opcode->max_ticks ? ticks : opcode->max_ticks;
+    opcode->num_lookups += after.num_lookups - before.num_lookups;
+    opcode->num_hops += after.num_hops - before.num_hops;
+    opcode->histogram[get_bucket(ticks)]++;
+
+    if (after.length > prof->max_length)
+    {
+        prof->max_length = after.length;
+    }
+}
+
+static void print_table(profiler *prof, list_stats *stats)
+{
+    fprintf(stderr, "%-12s %10s %16s %12s %12s %12s %12s %10s\n",
+            "opcode", "count", "total " TICK_UNIT, "mean", "p50 <", "p99 <", "max", "avg hops");
+
+    for (int i = 0; i < NUM_PROFILED_OPCODES; i++)
+    {
+        opcode_profile *opcode = &(prof->opcodes[i]);
+        if (!opcode->count)
+        {
+            continue;
+        }
+
+        fprintf(stderr, "%-12s %10ld %16llu %12.1f %12llu %12llu %12llu %10.1f\n",
+                opcode_names[i], opcode->count, opcode->total_ticks,
+                get_average(opcode->total_ticks, opcode->count),
+                get_percentile(opcode, 500), get_percentile(opcode, 990), opcode->max_ticks,
+                get_average(opcode->num_hops, opcode->num_lookups));
+    }
+
+    fprintf(stderr, "\nlatency histograms (" TICK_UNIT ")\n");
+    for (int i = 0; i < NUM_PROFILED_OPCODES; i++)
+    {
+        opcode_profile *opcode = &(prof->opcodes[i]);
+        if (!opcode->count)
+        {
+            continue;
+        }
+
+        fprintf(stderr, "%s\n", opcode_names[i]);
+        for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+        {
+            if (opcode->histogram[bucket])
+            {
+                fprintf(stderr, "  < %-20llu %ld\n", get_bucket_limit(bucket), opcode->histogram[bucket]);
+            }
+        }
+    }
+
+    fprintf(stderr, "\nlength %d, peak length %d, lookups %ld, avg hops per lookup %.1f\n",
+            stats->length, prof->max_length, stats->num_lookups,
+            get_average(stats->num_hops, stats->num_lookups));
+}
+
+static void print_json(profiler *prof, list_stats *stats)
+{
+    fprintf(stderr, "{\"unit\": \"" TICK_UNIT "\", \"opcodes\": {");
+
+    int is_first = 1;
+    for (int i = 0; i < NUM_PROFILED_OPCODES; i++)
+    {
+        opcode_profile *opcode = &(prof->opcodes[i]);
+        if (!opcode->count)
+        {
+            continue;
+        }
+
+        fprintf(stderr, "%s\"%s\": {\"count\": %ld, \"total\": %llu, \"max\": %llu, "
+                        "\"lookups\": %ld, \"hops\": %ld, \"histogram\": {",
+                is_first ? "" : ", ", opcode_names[i], opcode->count, opcode->total_ticks,
+                opcode->max_ticks, opcode->num_lookups, opcode->num_hops);
+        is_first = 0;
+
+        // keyed by the exclusive upper bound of each bucket
+        int is_first_bucket = 1;
+        for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+        {
+            if (opcode->histogram[bucket])
+            {
+                fprintf(stderr, "%s\"%llu\": %ld", is_first_bucket ? "" : ", ",
+                        get_bucket_limit(bucket), opcode->histogram[bucket]);
+                is_first_bucket = 0;
+            }
+        }
+        fprintf(stderr, "}}");
+    }
+
+    fprintf(stderr, "}, \"length\": %d, \"peak_length\": %d, \"lookups\": %ld, \"hops\": %ld}\n",
+            stats->length, prof->max_length, stats->num_lookups, stats->num_hops);
+}
+
+void print_profile(profiler *prof, list *lst)
+{
+    list_stats stats;
+    get_list_stats(lst, &stats);
+
+    if (prof->format == PROFILE_JSON)
+    {
+        print_json(prof, &stats);
+    }
+    else
+    {
+        print_table(prof, &stats);
+    }
+}
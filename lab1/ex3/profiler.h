@@ -0,0 +1,47 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "instruction_reader.h"
+#include "node.h"
+#include "runner.h"
+
+// One slot per runner opcode, anything else is counted as unknown
+#define NUM_PROFILED_OPCODES (SPLICE + 2)
+// Bucket b holds latencies in [2^(b-1), 2^b) ticks, bucket 0 holds 0
+#define NUM_LATENCY_BUCKETS 65
+
+#define PROFILE_TABLE 0
+#define PROFILE_JSON 1
+
+typedef struct
+{
+    long count;
+    unsigned long long total_ticks;
+    unsigned long long max_ticks;
+    long num_lookups;
+    long num_hops;
+    long histogram[NUM_LATENCY_BUCKETS];
+} opcode_profile;
+
+typedef struct
+{
+    int format;
+    int max_length;
+    opcode_profile opcodes[NUM_PROFILED_OPCODES];
+} profiler;
+
+void init_profiler(profiler *prof, int format);
+// Runs one instruction through run_instruction and records its latency
+// (operand decoding included) and the list lookups it did
+void profile_instruction(profiler *prof, list *lst, int instr, instruction_reader *reader);
+// Writes the summary to stderr so that the program output is unchanged
+void print_profile(profiler *prof, list *lst);
+
+#endif
@@ -0,0 +1,44 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "instruction_reader.h"
+#include "node.h"
+#include "output_writer.h"
+
+// Macros
+#define SUM_LIST 0
+#define INSERT_AT 1
+#define DELETE_AT 2
+#define ROTATE_LIST 3
+#define REVERSE_LIST 4
+#define RESET_LIST 5
+#define MAP 6
+// index, count, count values
+#define INSERT_RANGE 7
+// index, count
+#define DELETE_RANGE 8
+// index, count, count values that are built into a list of their own
+// and spliced in
+#define SPLICE 9
+
+// Runs every instruction left in reader, compiled to bytecode first if
+// is_bytecode_mode is 1
+void run_stream(list *lst, instruction_reader *reader, int is_bytecode_mode);
+void run_instruction(list *lst, int instr, instruction_reader *reader);
+void print_sum(list *lst);
+// Sends the output of the calling thread to writer, or back to stdout if
+// writer is NULL
+void set_output_writer(output_writer *writer);
+// Maps func_list[index], or the plugin after it for larger indices. An
+// index with neither is reported and skipped.
+void apply_function(list *lst, int index);
+void splice_values(list *lst, int index, const int *values, int num_values);
+
+#endif
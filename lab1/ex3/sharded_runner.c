@@ -0,0 +1,153 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "sharded_runner.h"
+#include "runner.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct
+{
+    char *file_name;
+    output_writer writer;
+    int is_done;
+    int has_error;
+} shard;
+
+// Shared by the workers, which take the next shard in file order
+typedef struct
+{
+    shard *shards;
+    int num_shards;
+    int next_shard;
+    int is_bytecode_mode;
+    pthread_mutex_t lock;
+    pthread_cond_t shard_done;
+} shard_queue;
+
+// Runs the file of a shard on a new list, with the output going to the
+// memory writer of the shard
+static void run_shard(shard *current_shard, int is_bytecode_mode)
+{
+    open_writer(&(current_shard->writer), MEMORY_WRITER);
+
+    int fd = open(current_shard->file_name, O_RDONLY);
+    instruction_reader reader;
+
+    if (fd == -1 || open_reader(&reader, fd) != 0)
+    {
+        fprintf(stderr, "Error: invalid file %s\n", current_shard->file_name);
+        current_shard->has_error = 1;
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return;
+    }
+
+    list lst;
+    init_list(&lst);
+
+    set_output_writer(&(current_shard->writer));
+    run_stream(&lst, &reader, is_bytecode_mode);
+    set_output_writer(NULL);
+
+    close_reader(&reader);
+    close(fd);
+    reset_list(&lst);
+}
+
+static void *run_worker(void *arg)
+{
+    shard_queue *queue = (shard_queue *)arg;
+
+    while (1)
+    {
+        pthread_mutex_lock(&(queue->lock));
+        int index = queue->next_shard < queue->num_shards ? queue->next_shard++ : -1;
+        pthread_mutex_unlock(&(queue->lock));
+
+        if (index == -1)
+        {
+            return NULL;
+        }
+
+        run_shard(&(queue->shards[index]), queue->is_bytecode_mode);
+
+        pthread_mutex_lock(&(queue->lock));
+        queue->shards[index].is_done = 1;
+        pthread_cond_broadcast(&(queue->shard_done));
+        pthread_mutex_unlock(&(queue->lock));
+    }
+}
+
+int run_sharded(char **file_names, int num_files, int num_workers, int is_bytecode_mode, output_writer *writer)
+{
+    shard_queue queue;
+    queue.shards = (shard *)calloc(num_files, sizeof(shard));
+    queue.num_shards = num_files;
+    queue.next_shard = 0;
+    queue.is_bytecode_mode = is_bytecode_mode;
+    pthread_mutex_init(&(queue.lock), NULL);
+    pthread_cond_init(&(queue.shard_done), NULL);
+
+    for (int i = 0; i < num_files; i++)
+    {
+        queue.shards[i].file_name = file_names[i];
+    }
+
+    if (num_workers > MAX_WORKERS)
+    {
+        num_workers = MAX_WORKERS;
+    }
+    if (num_workers > num_files)
+    {
+        num_workers = num_files;
+    }
+
+    pthread_t workers[MAX_WORKERS];
+    for (int i = 0; i < num_workers; i++)
+    {
+        if (pthread_create(&workers[i], NULL, run_worker, &queue) != 0)
+        {
+            perror("run_sharded: pthread_create error");
+            exit(1);
+        }
+    }
+
+    // the calling thread only writes out finished shards, in file order
+    int num_failed = 0;
+    for (int i = 0; i < num_files; i++)
+    {
+        shard *current_shard = &(queue.shards[i]);
+
+        pthread_mutex_lock(&(queue.lock));
+        while (!current_shard->is_done)
+        {
+            pthread_cond_wait(&(queue.shard_done), &(queue.lock));
+        }
+        pthread_mutex_unlock(&(queue.lock));
+
+        append_writer(writer, &(current_shard->writer));
+        close_writer(&(current_shard->writer));
+        num_failed += current_shard->has_error;
+    }
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&(queue.shard_done));
+    pthread_mutex_destroy(&(queue.lock));
+    free(queue.shards);
+    return num_failed;
+}
@@ -0,0 +1,21 @@
+/*************************************
+* Lab 1 Exercise 3
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef SHARDED_RUNNER_H
+#define SHARDED_RUNNER_H
+
+#include "output_writer.h"
+
+#define MAX_WORKERS 64
+
+// Runs every file on a list of its own, spread over num_workers threads.
+// The output of each file is kept in memory and written to writer in the
+// order of the files, as soon as every file before it is done. Returns
+// the number of files that could not be run.
+int run_sharded(char **file_names, int num_files, int num_workers, int is_bytecode_mode, output_writer *writer);
+
+#endif
@@ -0,0 +1,148 @@
+/*************************************
+* Lab 1 Exercise 5
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Prints the same report as the original check_system.sh without forking
+// uname, ps, sort, uniq, awk and free. Everything comes from uname(2),
+// getrlimit(2), /proc/meminfo and one pass over /proc/[pid]/status.
+
+#include "proc_stats.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+
+// Process counts gathered in a single pass over /proc
+typedef struct
+{
+    usage_table usage;
+    // processes whose real uid is the caller's, as in ps -U $(whoami)
+    int num_own_processes;
+} process_summary;
+
+// Counts every process by effective uid (the user column of ps) and the
+// processes of the caller by real uid
+static void summarise_processes(process_summary *summary)
+{
+    init_usage_table(&(summary->usage));
+    summary->num_own_processes = 0;
+
+    DIR *proc_dir = opendir("/proc");
+    if (!proc_dir)
+    {
+        perror("summarise_processes: opendir error");
+        exit(1);
+    }
+
+    int proc_fd = dirfd(proc_dir);
+    uid_t own_uid = geteuid();
+    char path[NAME_MAX + sizeof("/status")];
+    char status[STATUS_BUFFER_SIZE];
+    struct dirent *entry;
+
+    while ((entry = readdir(proc_dir)))
+    {
+        if (!is_pid(entry->d_name))
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/status", entry->d_name);
+
+        process_status process;
+        if (read_proc_file(proc_fd, path, status, sizeof(status)) <= 0 ||
+            parse_status(status, &process) != 0)
+        {
+            continue;
+        }
+
+        add_usage(&(summary->usage), process.effective_uid, process.rss_kb);
+        summary->num_own_processes += process.real_uid == own_uid;
+    }
+
+    closedir(proc_dir);
+}
+
+// Returns the name of the user with the most processes. Ties go to the
+// name that sorts last, like sort -nr on the output of uniq -c.
+static void get_busiest_user(usage_table *table, char *name, size_t name_size)
+{
+    int best_count = 0;
+    name[0] = '\0';
+
+    for (int i = 0; i < table->size; i++)
+    {
+        user_usage *usage = &(table->slots[i]);
+        if (!usage->num_processes || usage->num_processes < best_count)
+        {
+            continue;
+        }
+
+        char uid_name[32];
+        const char *user_name = get_user_name(usage->uid, uid_name, sizeof(uid_name));
+
+        if (usage->num_processes > best_count || strcmp(user_name, name) > 0)
+        {
+            best_count = usage->num_processes;
+            snprintf(name, name_size, "%s", user_name);
+        }
+    }
+}
+
+int main()
+{
+    struct utsname system_name;
+    if (uname(&system_name) != 0)
+    {
+        perror("uname error");
+        exit(1);
+    }
+
+    struct rlimit process_limit;
+    if (getrlimit(RLIMIT_NPROC, &process_limit) != 0)
+    {
+        perror("getrlimit error");
+        exit(1);
+    }
+
+    char meminfo[MEMINFO_BUFFER_SIZE];
+    if (read_proc_file(AT_FDCWD, "/proc/meminfo", meminfo, sizeof(meminfo)) <= 0)
+    {
+        perror("Error: cannot read /proc/meminfo");
+        exit(1);
+    }
+
+    process_summary summary;
+    summarise_processes(&summary);
+
+    char busiest_user[256];
+    get_busiest_user(&(summary.usage), busiest_user, sizeof(busiest_user));
+
+    printf("Hostname: %s\n", system_name.nodename);
+    printf("Machine Hardware: %s %s\n", system_name.sysname, system_name.machine);
+    if (process_limit.rlim_cur == RLIM_INFINITY)
+    {
+        printf("Max User Processes: unlimited\n");
+    }
+    else
+    {
+        printf("Max User Processes: %llu\n", (unsigned long long)process_limit.rlim_cur);
+    }
+    printf("User Processes: %d\n", summary.num_own_processes);
+    printf("User With Most Processes: %s\n", busiest_user);
+    // %g prints like awk (%.6g), nan included when there is no swap
+    printf("Memory Free (%%): %g\n", get_free_percentage(meminfo, "MemFree", "MemTotal"));
+    printf("Swap Free (%%): %g\n", get_free_percentage(meminfo, "SwapFree", "SwapTotal"));
+
+    free_usage_table(&(summary.usage));
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*************************************
+* Lab 1 Exercise 5
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#include "proc_stats.h"
+
+#include <fcntl.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Index of uid in a table of size slots. uids tend to be small and
+// consecutive, so the index comes from the top bits of the product, which
+// every bit of the uid contributes to.
+static unsigned int hash_uid(uid_t uid, int size)
+{
+    return ((unsigned int)uid * 2654435769u) >> (32 - __builtin_ctz(size));
+}
+
+static user_usage *find_slot(user_usage *slots, int size, uid_t uid)
+{
+    unsigned int index = hash_uid(uid, size);
+
+    while (slots[index].num_processes && slots[index].uid != uid)
+    {
+        index = (index + 1) & (size - 1);
+    }
+    return &slots[index];
+}
+
+// Doubles the table once it is half full so that probes stay short
+static void grow_table(usage_table *table)
+{
+    int new_size = table->size * 2;
+    user_usage *new_slots = (user_usage *)calloc(new_size, sizeof(user_usage));
+    if (!new_slots)
+    {
+        perror("grow_table: calloc error");
+        exit(1);
+    }
+
+    for (int i = 0; i < table->size; i++)
+    {
+        if (table->slots[i].num_processes)
+        {
+            *find_slot(new_slots, new_size, table->slots[i].uid) = table->slots[i];
+        }
+    }
+
+    free(table->slots);
+    table->slots = new_slots;
+    table->size = new_size;
+}
+
+void init_usage_table(usage_table *table)
+{
+    table->size = INITIAL_TABLE_SIZE;
+    table->num_used = 0;
+    table->slots = (user_usage *)calloc(table->size, sizeof(user_usage));
+    if (!table->slots)
+    {
+        perror("init_usage_table: calloc error");
+        exit(1);
+    }
+}
+
+void clear_usage_table(usage_table *table)
+{
+    memset(table->slots, 0, table->size * sizeof(user_usage));
+    table->num_used = 0;
+}
+
+void add_usage(usage_table *table, uid_t uid, long rss_kb)
+{
+    user_usage *slot = find_slot(table->slots, table->size, uid);
+
+    if (!slot->num_processes)
+    {
+        if (++table->num_used * 2 > table->size)
+        {
+            grow_table(table);
+            slot = find_slot(table->slots, table->size, uid);
+        }
+        // the slot is only claimed here, an empty one is not moved over
+        // when the table grows
+        slot->uid = uid;
+    }
+    slot->num_processes++;
+    slot->rss_kb += rss_kb;
+}
+
+void free_usage_table(usage_table *table)
+{
+    free(table->slots);
+    table->slots = NULL;
+}
+
+int is_pid(const char *name)
+{
+    if (!*name)
+    {
+        return 0;
+    }
+
+    for (; *name; name++)
+    {
+        if (*name < '0' || *name > '9')
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+ssize_t read_proc_file(int dir_fd, const char *path, char *buffer, size_t buffer_size)
+{
+    int fd = openat(dir_fd, path, O_RDONLY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    ssize_t num_read = read(fd, buffer, buffer_size - 1);
+    close(fd);
+
+    if (num_read >= 0)
+    {
+        buffer[num_read] = '\0';
+    }
+    return num_read;
+}
+
+int parse_status(const char *status, process_status *process)
+{
+    const char *line = strstr(status, "\nUid:");
+    if (!line)
+    {
+        return -1;
+    }
+
+    char *end;
+    process->real_uid = (uid_t)strtoul(line + 5, &end, 10);
+    process->effective_uid = (uid_t)strtoul(end, NULL, 10);
+
+    // VmRSS comes after Uid
+    line = strstr(line, "\nVmRSS:");
+    process->rss_kb = line ? strtol(line + 7, NULL, 10) : 0;
+    return 0;
+}
+
+long get_meminfo_field(const char *meminfo, const char *field)
+{
+    size_t field_length = strlen(field);
+
+    for (const char *line = meminfo; line; line = strchr(line, '\n'))
+    {
+        line += *line == '\n';
+        if (strncmp(line, field, field_length) == 0 && line[field_length] == ':')
+        {
+            return strtol(line + field_length + 1, NULL, 10);
+        }
+    }
+    return -1;
+}
+
+double get_free_percentage(const char *meminfo, const char *free_field, const char *total_field)
+{
+    return get_meminfo_field(meminfo, free_field) * 100.0 / get_meminfo_field(meminfo, total_field);
+}
+
+const char *get_user_name(uid_t uid, char *buffer, size_t buffer_size)
+{
+    struct passwd *user = getpwuid(uid);
+    if (user)
+    {
+        return user->pw_name;
+    }
+
+    snprintf(buffer, buffer_size, "%u", (unsigned int)uid);
+    return buffer;
+}
@@ -0,0 +1,64 @@
+/*************************************
+* Lab 1 Exercise 5
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+#ifndef PROC_STATS_H
+#define PROC_STATS_H
+
+#include <sys/types.h>
+
+#define STATUS_BUFFER_SIZE 4096
+#define MEMINFO_BUFFER_SIZE 8192
+#define INITIAL_TABLE_SIZE 64
+
+// What a process uses, as read from /proc/[pid]/status
+typedef struct
+{
+    uid_t real_uid;
+    uid_t effective_uid;
+    // 0 for kernel threads, which have no VmRSS line
+    long rss_kb;
+} process_status;
+
+// Processes and resident memory of one user
+typedef struct
+{
+    uid_t uid;
+    int num_processes;
+    long rss_kb;
+} user_usage;
+
+// Open addressing table from uid to usage. A slot is empty when its
+// num_processes is 0.
+typedef struct
+{
+    user_usage *slots;
+    // always a power of 2
+    int size;
+    int num_used;
+} usage_table;
+
+void init_usage_table(usage_table *table);
+// Empties the table, keeping its slots for the next round
+void clear_usage_table(usage_table *table);
+void add_usage(usage_table *table, uid_t uid, long rss_kb);
+void free_usage_table(usage_table *table);
+
+// 1 if name is the directory of a process in /proc
+int is_pid(const char *name);
+// Reads a small /proc file into buffer as a string, returns its length
+// or -1 (the process may have exited in the meantime)
+ssize_t read_proc_file(int dir_fd, const char *path, char *buffer, size_t buffer_size);
+// returns 0 on success else -1
+int parse_status(const char *status, process_status *process);
+// Returns the value in kB of a field of /proc/meminfo, or -1
+long get_meminfo_field(const char *meminfo, const char *field);
+// free as a percentage of total, nan without a total (e.g. no swap)
+double get_free_percentage(const char *meminfo, const char *free_field, const char *total_field);
+// Name of uid, or the uid itself if it has no passwd entry
+const char *get_user_name(uid_t uid, char *buffer, size_t buffer_size);
+
+#endif
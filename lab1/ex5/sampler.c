@@ -0,0 +1,591 @@
+/*************************************
+* Lab 1 Exercise 5
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Samples memory free %, swap free % and per user process counts and
+// resident memory every interval, keeping the last samples in a ring
+// buffer. Every /proc file it reads is opened once and read again with
+// pread on later rounds, so a sample costs one readdir of /proc and one
+// pread per process.
+//
+// Usage: sampler [--interval ms] [--history samples] [--top n] [--count samples]
+//   SIGUSR1 dumps the history, oldest sample first
+//   SIGUSR2 prints the top users by process count and by resident memory
+//   SIGINT and SIGTERM dump the history and exit, as does reaching --count
+
+#include "proc_stats.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define INTERVAL_FLAG "--interval"
+#define HISTORY_FLAG "--history"
+#define TOP_FLAG "--top"
+#define COUNT_FLAG "--count"
+
+#define DEFAULT_INTERVAL_MS 100
+#define DEFAULT_HISTORY_SIZE 600
+#define DEFAULT_TOP_SIZE 3
+#define MAX_TOP_SIZE 16
+#define INITIAL_PROCESS_CAPACITY 256
+// descriptors left for stdio, /proc and /proc/meminfo
+#define RESERVED_FILES 16
+#define FALLBACK_MAX_OPEN 1024
+
+// An open /proc/[pid]/status, fd is -1 if it could not be kept open
+// (e.g. out of file descriptors) and is opened on every round instead
+typedef struct
+{
+    int pid;
+    int fd;
+} status_file;
+
+typedef struct
+{
+    double seconds;
+    double mem_free;
+    double swap_free;
+    int num_processes;
+    int num_top;
+    user_usage top_by_processes[MAX_TOP_SIZE];
+} sample;
+
+typedef struct
+{
+    int proc_fd;
+    DIR *proc_dir;
+    int meminfo_fd;
+    // status files of the last round sorted by pid, reused this round
+    status_file *files;
+    int num_files;
+    int capacity;
+    status_file *next_files;
+    // status files kept open, at most max_open to leave descriptors free
+    int num_open;
+    int max_open;
+    usage_table usage;
+    // ring buffer of the last history_size samples
+    sample *history;
+    int history_size;
+    int num_samples;
+    int next_sample;
+    int top_size;
+    struct timespec start_time;
+} sampler;
+
+static volatile sig_atomic_t is_dump_requested = 0;
+static volatile sig_atomic_t is_top_requested = 0;
+static volatile sig_atomic_t is_stopping = 0;
+
+static void handle_signal(int signum)
+{
+    if (signum == SIGUSR1)
+    {
+        is_dump_requested = 1;
+    }
+    else if (signum == SIGUSR2)
+    {
+        is_top_requested = 1;
+    }
+    else
+    {
+        is_stopping = 1;
+    }
+}
+
+static void *allocate(size_t size)
+{
+    void *memory = malloc(size);
+    if (!memory)
+    {
+        perror("sampler: malloc error");
+        exit(1);
+    }
+    return memory;
+}
+
+static int compare_pids(const void *a, const void *b)
+{
+    return ((const status_file *)a)->pid - ((const status_file *)b)->pid;
+}
+
+static int compare_by_processes(const user_usage *a, const user_usage *b)
+{
+    if (a->num_processes != b->num_processes)
+    {
+        return b->num_processes - a->num_processes;
+    }
+    return a->uid < b->uid ? -1 : a->uid > b->uid;
+}
+
+static int compare_by_rss(const user_usage *a, const user_usage *b)
+{
+    if (a->rss_kb != b->rss_kb)
+    {
+        return b->rss_kb < a->rss_kb ? -1 : 1;
+    }
+    return a->uid < b->uid ? -1 : a->uid > b->uid;
+}
+
+static void swap_usage(user_usage *a, user_usage *b)
+{
+    user_usage temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Moves the n first users in the given order to the front of users and
+// sorts them, without sorting the rest (quickselect, O(num_users))
+static void select_top(user_usage *users, int num_users, int n, int (*compare)(const user_usage *, const user_usage *))
+{
+    int low = 0;
+    int high = num_users - 1;
+
+    while (low < high)
+    {
+        // median of three as the pivot, kept at high
+        int middle = low + (high - low) / 2;
+        if (compare(&users[middle], &users[low]) < 0)
+        {
+            swap_usage(&users[middle], &users[low]);
+        }
+        if (compare(&users[high], &users[low]) < 0)
+        {
+            swap_usage(&users[high], &users[low]);
+        }
+        if (compare(&users[middle], &users[high]) < 0)
+        {
+            swap_usage(&users[middle], &users[high]);
+        }
+
+        int store = low;
+        for (int i = low; i < high; i++)
+        {
+            if (compare(&users[i], &users[high]) < 0)
+            {
+                swap_usage(&users[i], &users[store++]);
+            }
+        }
+        swap_usage(&users[store], &users[high]);
+
+        if (store == n - 1 || store == n)
+        {
+            break;
+        }
+        if (store < n)
+        {
+            low = store + 1;
+        }
+        else
+        {
+            high = store - 1;
+        }
+    }
+
+    // insertion sort of the top n, which is small
+    n = n < num_users ? n : num_users;
+    for (int i = 1; i < n; i++)
+    {
+        for (int j = i; j > 0 && compare(&users[j], &users[j - 1]) < 0; j--)
+        {
+            swap_usage(&users[j], &users[j - 1]);
+        }
+    }
+}
+
+// Copies the used slots of the usage table into users, returns how many
+static int collect_users(usage_table *table, user_usage *users)
+{
+    int num_users = 0;
+    for (int i = 0; i < table->size; i++)
+    {
+        if (table->slots[i].num_processes)
+        {
+            users[num_users++] = table->slots[i];
+        }
+    }
+    return num_users;
+}
+
+static void init_sampler(sampler *smp, int history_size, int top_size)
+{
+    smp->proc_dir = opendir("/proc");
+    smp->meminfo_fd = open("/proc/meminfo", O_RDONLY);
+    if (!smp->proc_dir || smp->meminfo_fd == -1)
+    {
+        perror("init_sampler: cannot open /proc");
+        exit(1);
+    }
+    smp->proc_fd = dirfd(smp->proc_dir);
+
+    smp->capacity = INITIAL_PROCESS_CAPACITY;
+    smp->files = (status_file *)allocate(smp->capacity * sizeof(status_file));
+    smp->next_files = (status_file *)allocate(smp->capacity * sizeof(status_file));
+    smp->num_files = 0;
+
+    struct rlimit file_limit;
+    smp->num_open = 0;
+    smp->max_open = FALLBACK_MAX_OPEN;
+    if (getrlimit(RLIMIT_NOFILE, &file_limit) == 0 && file_limit.rlim_cur != RLIM_INFINITY)
+    {
+        smp->max_open = (int)file_limit.rlim_cur - RESERVED_FILES;
+    }
+    init_usage_table(&(smp->usage));
+
+    smp->history = (sample *)allocate(history_size * sizeof(sample));
+    smp->history_size = history_size;
+    smp->num_samples = 0;
+    smp->next_sample = 0;
+    smp->top_size = top_size;
+    clock_gettime(CLOCK_MONOTONIC, &(smp->start_time));
+}
+
+static void close_status(sampler *smp, status_file *file)
+{
+    if (file->fd != -1)
+    {
+        close(file->fd);
+        file->fd = -1;
+        smp->num_open--;
+    }
+}
+
+static void close_sampler(sampler *smp)
+{
+    for (int i = 0; i < smp->num_files; i++)
+    {
+        close_status(smp, &(smp->files[i]));
+    }
+
+    free(smp->files);
+    free(smp->next_files);
+    free(smp->history);
+    free_usage_table(&(smp->usage));
+    close(smp->meminfo_fd);
+    closedir(smp->proc_dir);
+}
+
+// Reads the status of file into buffer. A kept open file of a process
+// that has exited fails to read, in which case the pid may have been
+// reused and the file is opened again once. Past max_open the file is
+// read without keeping it open.
+static ssize_t read_status(sampler *smp, status_file *file, char *buffer, size_t buffer_size)
+{
+    ssize_t num_read;
+
+    if (file->fd != -1)
+    {
+        num_read = pread(file->fd, buffer, buffer_size - 1, 0);
+        if (num_read > 0)
+        {
+            buffer[num_read] = '\0';
+            return num_read;
+        }
+        close_status(smp, file);
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "%d/status", file->pid);
+    if (smp->num_open >= smp->max_open)
+    {
+        return read_proc_file(smp->proc_fd, path, buffer, buffer_size);
+    }
+
+    file->fd = openat(smp->proc_fd, path, O_RDONLY);
+    if (file->fd == -1)
+    {
+        return -1;
+    }
+    smp->num_open++;
+
+    num_read = pread(file->fd, buffer, buffer_size - 1, 0);
+    if (num_read >= 0)
+    {
+        buffer[num_read] = '\0';
+    }
+    return num_read;
+}
+
+// Lists the pids in /proc into next_files in ascending order, then walks
+// it alongside the files of the last round: a pid in both keeps its fd,
+// a pid only in the old list has exited and its fd is closed.
+static void update_files(sampler *smp)
+{
+    int num_next = 0;
+    int is_sorted = 1;
+    struct dirent *entry;
+
+    rewinddir(smp->proc_dir);
+    while ((entry = readdir(smp->proc_dir)))
+    {
+        if (!is_pid(entry->d_name))
+        {
+            continue;
+        }
+
+        if (num_next == smp->capacity)
+        {
+            smp->capacity *= 2;
+            smp->next_files = (status_file *)realloc(smp->next_files, smp->capacity * sizeof(status_file));
+            smp->files = (status_file *)realloc(smp->files, smp->capacity * sizeof(status_file));
+            if (!smp->next_files || !smp->files)
+            {
+                perror("update_files: realloc error");
+                exit(1);
+            }
+        }
+
+        int pid = atoi(entry->d_name);
+        is_sorted &= num_next == 0 || smp->next_files[num_next - 1].pid < pid;
+        smp->next_files[num_next].pid = pid;
+        smp->next_files[num_next].fd = -1;
+        num_next++;
+    }
+
+    // /proc lists processes by pid, sort just in case
+    if (!is_sorted)
+    {
+        qsort(smp->next_files, num_next, sizeof(status_file), compare_pids);
+    }
+
+    int old_index = 0;
+    for (int i = 0; i < num_next; i++)
+    {
+        while (old_index < smp->num_files && smp->files[old_index].pid < smp->next_files[i].pid)
+        {
+            close_status(smp, &(smp->files[old_index]));
+            old_index++;
+        }
+
+        if (old_index < smp->num_files && smp->files[old_index].pid == smp->next_files[i].pid)
+        {
+            smp->next_files[i].fd = smp->files[old_index++].fd;
+        }
+    }
+    for (; old_index < smp->num_files; old_index++)
+    {
+        close_status(smp, &(smp->files[old_index]));
+    }
+
+    status_file *temp = smp->files;
+    smp->files = smp->next_files;
+    smp->next_files = temp;
+    smp->num_files = num_next;
+}
+
+static void take_sample(sampler *smp)
+{
+    char buffer[MEMINFO_BUFFER_SIZE];
+    sample *current = &(smp->history[smp->next_sample]);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    current->seconds = (now.tv_sec - smp->start_time.tv_sec) + (now.tv_nsec - smp->start_time.tv_nsec) / 1e9;
+
+    ssize_t num_read = pread(smp->meminfo_fd, buffer, sizeof(buffer) - 1, 0);
+    buffer[num_read > 0 ? num_read : 0] = '\0';
+    current->mem_free = get_free_percentage(buffer, "MemFree", "MemTotal");
+    current->swap_free = get_free_percentage(buffer, "SwapFree", "SwapTotal");
+
+    update_files(smp);
+    clear_usage_table(&(smp->usage));
+    current->num_processes = 0;
+
+    for (int i = 0; i < smp->num_files; i++)
+    {
+        process_status process;
+        if (read_status(smp, &(smp->files[i]), buffer, STATUS_BUFFER_SIZE) <= 0 ||
+            parse_status(buffer, &process) != 0)
+        {
+            continue;
+        }
+
+        add_usage(&(smp->usage), process.effective_uid, process.rss_kb);
+        current->num_processes++;
+    }
+
+    // only the top users by process count are kept in the history
+    user_usage *users = (user_usage *)allocate((smp->usage.num_used + 1) * sizeof(user_usage));
+    int num_users = collect_users(&(smp->usage), users);
+    select_top(users, num_users, smp->top_size, compare_by_processes);
+
+    current->num_top = num_users < smp->top_size ? num_users : smp->top_size;
+    memcpy(current->top_by_processes, users, current->num_top * sizeof(user_usage));
+    free(users);
+
+    smp->next_sample = (smp->next_sample + 1) % smp->history_size;
+    if (smp->num_samples < smp->history_size)
+    {
+        smp->num_samples++;
+    }
+}
+
+static void print_users(const user_usage *users, int num_users)
+{
+    for (int i = 0; i < num_users; i++)
+    {
+        char uid_name[32];
+        printf(" %s(%d)", get_user_name(users[i].uid, uid_name, sizeof(uid_name)), users[i].num_processes);
+    }
+    printf("\n");
+}
+
+static void dump_history(sampler *smp)
+{
+    printf("%-10s %-16s %-14s %-10s %s\n", "Time (s)", "Memory Free (%)", "Swap Free (%)", "Processes", "Top Users");
+
+    int index = (smp->next_sample - smp->num_samples + smp->history_size) % smp->history_size;
+    for (int i = 0; i < smp->num_samples; i++)
+    {
+        sample *current = &(smp->history[index]);
+        printf("%-10.3f %-16g %-14g %-10d", current->seconds, current->mem_free, current->swap_free, current->num_processes);
+        print_users(current->top_by_processes, current->num_top);
+        index = (index + 1) % smp->history_size;
+    }
+    fflush(stdout);
+}
+
+// Ranks the users of the latest sample by process count and by resident
+// memory
+static void print_top(sampler *smp)
+{
+    user_usage *users = (user_usage *)allocate((smp->usage.num_used + 1) * sizeof(user_usage));
+    int num_users = collect_users(&(smp->usage), users);
+    int num_top = num_users < smp->top_size ? num_users : smp->top_size;
+
+    printf("Top users by processes:\n");
+    select_top(users, num_users, smp->top_size, compare_by_processes);
+    for (int i = 0; i < num_top; i++)
+    {
+        char uid_name[32];
+        printf("%-16s %d\n", get_user_name(users[i].uid, uid_name, sizeof(uid_name)), users[i].num_processes);
+    }
+
+    printf("Top users by RSS (kB):\n");
+    select_top(users, num_users, smp->top_size, compare_by_rss);
+    for (int i = 0; i < num_top; i++)
+    {
+        char uid_name[32];
+        printf("%-16s %ld\n", get_user_name(users[i].uid, uid_name, sizeof(uid_name)), users[i].rss_kb);
+    }
+
+    fflush(stdout);
+    free(users);
+}
+
+// Sleeps until deadline. Returns 1 once it is reached, or 0 early if a
+// signal asked for something.
+static int wait_until(const struct timespec *deadline)
+{
+    while (!is_dump_requested && !is_top_requested && !is_stopping)
+    {
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) != EINTR)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    int history_size = DEFAULT_HISTORY_SIZE;
+    int top_size = DEFAULT_TOP_SIZE;
+    // 0 samples until stopped by a signal
+    int max_samples = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            fprintf(stderr, "Error: missing value for %s\n", argv[i]);
+            exit(1);
+        }
+
+        if (strcmp(argv[i], INTERVAL_FLAG) == 0)
+        {
+            interval_ms = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], HISTORY_FLAG) == 0)
+        {
+            history_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], TOP_FLAG) == 0)
+        {
+            top_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], COUNT_FLAG) == 0)
+        {
+            max_samples = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Error: unknown argument %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (interval_ms < 1 || history_size < 1 || top_size < 1 || top_size > MAX_TOP_SIZE || max_samples < 0)
+    {
+        fprintf(stderr, "Error: expecting positive %s and %s, and %s of at most %d\n", INTERVAL_FLAG, HISTORY_FLAG, TOP_FLAG, MAX_TOP_SIZE);
+        exit(1);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    sigemptyset(&(action.sa_mask));
+    sigaction(SIGUSR1, &action, NULL);
+    sigaction(SIGUSR2, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    sampler smp;
+    init_sampler(&smp, history_size, top_size);
+
+    struct timespec deadline = smp.start_time;
+    int num_taken = 0;
+    while (!is_stopping)
+    {
+        take_sample(&smp);
+        if (max_samples && ++num_taken == max_samples)
+        {
+            break;
+        }
+
+        // fixed rate, a slow sample does not push back the ones after it
+        deadline.tv_nsec += interval_ms % 1000 * 1000000L;
+        deadline.tv_sec += interval_ms / 1000 + deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        while (!wait_until(&deadline) && !is_stopping)
+        {
+            if (is_dump_requested)
+            {
+                is_dump_requested = 0;
+                dump_history(&smp);
+            }
+            if (is_top_requested)
+            {
+                is_top_requested = 0;
+                print_top(&smp);
+            }
+        }
+    }
+
+    dump_history(&smp);
+    close_sampler(&smp);
+    return 0;
+}
@@ -12,5 +12,9 @@ echo "Printing system call report"
 # Compile file
 gcc -std=c99 pid_checker.c -o ex6
 
-# Use strace to get report
-strace -c ./ex6
\ No newline at end of file
+# Compile the syscall profiler, which counts calls from inside the
+# process instead of stopping it on every call like strace does
+gcc -std=c99 -Wall -Wextra -D_GNU_SOURCE -O2 -shared -fPIC syscall_profiler.c -o syscall_profiler.so -ldl
+
+# Use the profiler to get report
+LD_PRELOAD=./syscall_profiler.so ./ex6
@@ -0,0 +1,425 @@
+/*************************************
+* Lab 1 Exercise 6
+* Name: Tan Kai Qun, Jeremy
+* Student No: A0136134N
+* Lab Group: 18
+*************************************/
+
+// Syscall profiler to be loaded with LD_PRELOAD in place of strace -c.
+// It wraps the libc functions that make system calls, forwards each call
+// to the real function and records its count, errors and latency in a
+// buffer of the calling thread. The summary is written to stderr at exit
+// in the strace -c layout, followed by latency percentiles.
+//
+// Only calls that go through the dynamic symbol table are seen. Calls
+// libc makes internally (e.g. the write behind printf, or the mmap and
+// brk of malloc) and those made before the library is loaded are not.
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Bucket b holds latencies in [2^(b-1), 2^b) ns, bucket 0 holds 0
+#define NUM_LATENCY_BUCKETS 65
+
+// Slots are named after the system call a wrapper makes, so that the
+// summary reads like that of strace. Wrappers of the same system call
+// (e.g. fstat and stat) share a slot.
+#define SYSCALL_LIST(X) \
+    X(READ, "read")                       \
+    X(WRITE, "write")                     \
+    X(PREAD64, "pread64")                 \
+    X(PWRITE64, "pwrite64")               \
+    X(OPENAT, "openat")                   \
+    X(CLOSE, "close")                     \
+    X(LSEEK, "lseek")                     \
+    X(NEWFSTATAT, "newfstatat")           \
+    X(MMAP, "mmap")                       \
+    X(MUNMAP, "munmap")                   \
+    X(MPROTECT, "mprotect")               \
+    X(IOCTL, "ioctl")                     \
+    X(FCNTL, "fcntl")                     \
+    X(ACCESS, "access")                   \
+    X(DUP, "dup")                         \
+    X(DUP2, "dup2")                       \
+    X(PIPE2, "pipe2")                     \
+    X(GETPID, "getpid")                   \
+    X(GETPPID, "getppid")                 \
+    X(CLONE, "clone")                     \
+    X(EXECVE, "execve")                   \
+    X(WAIT4, "wait4")                     \
+    X(KILL, "kill")                       \
+    X(CLOCK_NANOSLEEP, "clock_nanosleep")
+
+#define SYSCALL_ID(id, name) SYS_ID_##id,
+#define SYSCALL_NAME(id, name) name,
+
+enum
+{
+    SYSCALL_LIST(SYSCALL_ID)
+    NUM_SYSCALLS
+};
+
+static const char *syscall_names[] = {SYSCALL_LIST(SYSCALL_NAME)};
+
+typedef struct
+{
+    long calls;
+    long errors;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    long histogram[NUM_LATENCY_BUCKETS];
+} syscall_stats;
+
+// One per thread, linked into all_stats on the first call of the thread
+// and never freed, so that threads that have exited are still counted
+typedef struct THREAD_STATS
+{
+    syscall_stats syscalls[NUM_SYSCALLS];
+    struct THREAD_STATS *next;
+} thread_stats;
+
+static __thread thread_stats *local_stats = NULL;
+static thread_stats *all_stats = NULL;
+// cleared in forked children, which would otherwise print the counts
+// they inherited, and while the summary is printed
+static int is_recording = 1;
+
+static unsigned long long read_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int get_bucket(unsigned long long ns)
+{
+    return ns ? 64 - __builtin_clzll(ns) : 0;
+}
+
+// Exclusive upper bound of the bucket
+static unsigned long long get_bucket_limit(int bucket)
+{
+    return bucket >= 64 ? ~0ULL : 1ULL << bucket;
+}
+
+static void *resolve(const char *symbol)
+{
+    void *function = dlsym(RTLD_NEXT, symbol);
+    if (!function)
+    {
+        fprintf(stderr, "syscall_profiler: cannot find %s\n", symbol);
+        abort();
+    }
+    return function;
+}
+
+static thread_stats *get_local_stats()
+{
+    if (!local_stats)
+    {
+        local_stats = (thread_stats *)calloc(1, sizeof(thread_stats));
+        if (!local_stats)
+        {
+            return NULL;
+        }
+
+        local_stats->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&all_stats, &(local_stats->next), local_stats, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+        }
+    }
+    return local_stats;
+}
+
+// Records a call that started at start_ns, and an error if is_error. errno
+// is kept since the caller may look at it.
+static void record_call(int id, unsigned long long start_ns, int is_error)
+{
+    unsigned long long ns = read_ns() - start_ns;
+    int saved_errno = errno;
+    thread_stats *stats = get_local_stats();
+
+    if (stats && __atomic_load_n(&is_recording, __ATOMIC_RELAXED))
+    {
+        syscall_stats *syscall = &(stats->syscalls[id]);
+        syscall->calls++;
+        syscall->errors += is_error;
+        syscall->total_ns += ns;
+        syscall->max_ns = ns > syscall->max_ns ? ns : syscall->max_ns;
+        syscall->histogram[get_bucket(ns)]++;
+    }
+
+    errno = saved_errno;
+}
+
+// Defines a wrapper of function that forwards to the real one and records
+// the call in the slot id. Every wrapped function signals errors with -1
+// (MAP_FAILED for mmap).
+#define WRAP(id, return_type, function, params, args)                             \
+    return_type function params                                                    \
+    {                                                                              \
+        static return_type(*real_##function) params = NULL;                        \
+        if (!real_##function)                                                      \
+        {                                                                          \
+            real_##function = (return_type(*) params)resolve(#function);           \
+        }                                                                          \
+        unsigned long long start_ns = read_ns();                                   \
+        return_type result = real_##function args;                                 \
+        record_call(SYS_ID_##id, start_ns, result == (return_type)-1);             \
+        return result;                                                             \
+    }
+
+WRAP(READ, ssize_t, read, (int fd, void *buffer, size_t count), (fd, buffer, count))
+WRAP(WRITE, ssize_t, write, (int fd, const void *buffer, size_t count), (fd, buffer, count))
+WRAP(PREAD64, ssize_t, pread, (int fd, void *buffer, size_t count, off_t offset), (fd, buffer, count, offset))
+WRAP(PWRITE64, ssize_t, pwrite, (int fd, const void *buffer, size_t count, off_t offset), (fd, buffer, count, offset))
+WRAP(CLOSE, int, close, (int fd), (fd))
+WRAP(LSEEK, off_t, lseek, (int fd, off_t offset, int whence), (fd, offset, whence))
+WRAP(NEWFSTATAT, int, fstat, (int fd, struct stat *file_stat), (fd, file_stat))
+WRAP(NEWFSTATAT, int, stat, (const char *path, struct stat *file_stat), (path, file_stat))
+WRAP(NEWFSTATAT, int, lstat, (const char *path, struct stat *file_stat), (path, file_stat))
+WRAP(MMAP, void *, mmap, (void *address, size_t length, int protection, int flags, int fd, off_t offset),
+     (address, length, protection, flags, fd, offset))
+WRAP(MUNMAP, int, munmap, (void *address, size_t length), (address, length))
+WRAP(MPROTECT, int, mprotect, (void *address, size_t length, int protection), (address, length, protection))
+WRAP(ACCESS, int, access, (const char *path, int mode), (path, mode))
+WRAP(DUP, int, dup, (int fd), (fd))
+WRAP(DUP2, int, dup2, (int fd, int new_fd), (fd, new_fd))
+WRAP(PIPE2, int, pipe, (int fds[2]), (fds))
+WRAP(GETPID, pid_t, getpid, (void), ())
+WRAP(GETPPID, pid_t, getppid, (void), ())
+WRAP(CLONE, pid_t, fork, (void), ())
+WRAP(EXECVE, int, execve, (const char *path, char *const argv[], char *const envp[]), (path, argv, envp))
+WRAP(WAIT4, pid_t, waitpid, (pid_t pid, int *status, int options), (pid, status, options))
+WRAP(WAIT4, pid_t, wait, (int *status), (status))
+WRAP(KILL, int, kill, (pid_t pid, int signum), (pid, signum))
+WRAP(CLOCK_NANOSLEEP, int, nanosleep, (const struct timespec *duration, struct timespec *remaining),
+     (duration, remaining))
+
+// The variadic ones take their optional argument as a plain value, which
+// is how the real functions read it
+
+int open(const char *path, int flags, ...)
+{
+    static int (*real_open)(const char *, int, ...) = NULL;
+    if (!real_open)
+    {
+        real_open = (int (*)(const char *, int, ...))resolve("open");
+    }
+
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+
+    unsigned long long start_ns = read_ns();
+    int fd = real_open(path, flags, mode);
+    record_call(SYS_ID_OPENAT, start_ns, fd == -1);
+    return fd;
+}
+
+int openat(int dir_fd, const char *path, int flags, ...)
+{
+    static int (*real_openat)(int, const char *, int, ...) = NULL;
+    if (!real_openat)
+    {
+        real_openat = (int (*)(int, const char *, int, ...))resolve("openat");
+    }
+
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+
+    unsigned long long start_ns = read_ns();
+    int fd = real_openat(dir_fd, path, flags, mode);
+    record_call(SYS_ID_OPENAT, start_ns, fd == -1);
+    return fd;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    static int (*real_ioctl)(int, unsigned long, ...) = NULL;
+    if (!real_ioctl)
+    {
+        real_ioctl = (int (*)(int, unsigned long, ...))resolve("ioctl");
+    }
+
+    va_list args;
+    va_start(args, request);
+    void *argument = va_arg(args, void *);
+    va_end(args);
+
+    unsigned long long start_ns = read_ns();
+    int result = real_ioctl(fd, request, argument);
+    record_call(SYS_ID_IOCTL, start_ns, result == -1);
+    return result;
+}
+
+int fcntl(int fd, int command, ...)
+{
+    static int (*real_fcntl)(int, int, ...) = NULL;
+    if (!real_fcntl)
+    {
+        real_fcntl = (int (*)(int, int, ...))resolve("fcntl");
+    }
+
+    va_list args;
+    va_start(args, command);
+    void *argument = va_arg(args, void *);
+    va_end(args);
+
+    unsigned long long start_ns = read_ns();
+    int result = real_fcntl(fd, command, argument);
+    record_call(SYS_ID_FCNTL, start_ns, result == -1);
+    return result;
+}
+
+// Adds the buffers of every thread into total
+static void merge_stats(syscall_stats *total)
+{
+    memset(total, 0, NUM_SYSCALLS * sizeof(syscall_stats));
+
+    for (thread_stats *stats = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE); stats; stats = stats->next)
+    {
+        for (int id = 0; id < NUM_SYSCALLS; id++)
+        {
+            syscall_stats *syscall = &(stats->syscalls[id]);
+            total[id].calls += syscall->calls;
+            total[id].errors += syscall->errors;
+            total[id].total_ns += syscall->total_ns;
+            total[id].max_ns = syscall->max_ns > total[id].max_ns ? syscall->max_ns : total[id].max_ns;
+            for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+            {
+                total[id].histogram[bucket] += syscall->histogram[bucket];
+            }
+        }
+    }
+}
+
+// Upper bound on the latency below which the given permille of the calls
+// fall, at most the largest latency seen
+static unsigned long long get_percentile(syscall_stats *syscall, int permille)
+{
+    long target = (syscall->calls * permille + 999) / 1000;
+    long seen = 0;
+
+    for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; bucket++)
+    {
+        seen += syscall->histogram[bucket];
+        if (seen >= target)
+        {
+            unsigned long long limit = get_bucket_limit(bucket);
+            return limit < syscall->max_ns ? limit : syscall->max_ns;
+        }
+    }
+
+    return syscall->max_ns;
+}
+
+static void print_errors(long errors)
+{
+    if (errors)
+    {
+        fprintf(stderr, " %9ld", errors);
+    }
+    else
+    {
+        fprintf(stderr, " %9s", "");
+    }
+}
+
+static void print_summary(syscall_stats *total)
+{
+    // most time first, like strace -c
+    int order[NUM_SYSCALLS];
+    int num_used = 0;
+    for (int id = 0; id < NUM_SYSCALLS; id++)
+    {
+        if (!total[id].calls)
+        {
+            continue;
+        }
+
+        int position = num_used++;
+        while (position > 0 && total[order[position - 1]].total_ns < total[id].total_ns)
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = id;
+    }
+
+    long all_calls = 0, all_errors = 0;
+    unsigned long long all_ns = 0;
+    for (int i = 0; i < num_used; i++)
+    {
+        all_calls += total[order[i]].calls;
+        all_errors += total[order[i]].errors;
+        all_ns += total[order[i]].total_ns;
+    }
+
+    const char *separator = "------ ----------- ----------- --------- --------- ----------------\n";
+    fprintf(stderr, "%% time     seconds  usecs/call     calls    errors syscall\n%s", separator);
+
+    for (int i = 0; i < num_used; i++)
+    {
+        syscall_stats *syscall = &(total[order[i]]);
+        fprintf(stderr, "%6.2f %11.6f %11llu %9ld", all_ns ? 100.0 * syscall->total_ns / all_ns : 0,
+                syscall->total_ns / 1e9, syscall->total_ns / 1000 / syscall->calls, syscall->calls);
+        print_errors(syscall->errors);
+        fprintf(stderr, " %s\n", syscall_names[order[i]]);
+    }
+
+    fprintf(stderr, "%s%6.2f %11.6f %11llu %9ld", separator, 100.0, all_ns / 1e9,
+            all_calls ? all_ns / 1000 / all_calls : 0, all_calls);
+    print_errors(all_errors);
+    fprintf(stderr, " total\n");
+
+    fprintf(stderr, "\n%-16s %12s %12s %12s %12s\n", "syscall", "p50 ns <", "p90 ns <", "p99 ns <", "max ns");
+    for (int i = 0; i < num_used; i++)
+    {
+        syscall_stats *syscall = &(total[order[i]]);
+        fprintf(stderr, "%-16s %12llu %12llu %12llu %12llu\n", syscall_names[order[i]],
+                get_percentile(syscall, 500), get_percentile(syscall, 900), get_percentile(syscall, 990),
+                syscall->max_ns);
+    }
+}
+
+static void stop_recording()
+{
+    __atomic_store_n(&is_recording, 0, __ATOMIC_RELAXED);
+}
+
+__attribute__((constructor)) static void start_profiler()
+{
+    pthread_atfork(NULL, NULL, stop_recording);
+}
+
+__attribute__((destructor)) static void print_profile()
+{
+    if (!__atomic_load_n(&is_recording, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+    stop_recording();
+
+    syscall_stats total[NUM_SYSCALLS];
+    merge_stats(total);
+    print_summary(total);
+}
@@ -10,7 +10,10 @@
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
+#include <spawn.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -22,26 +25,122 @@
 #define RUNNING 0
 #define EXITED 1
 #define TERMINATING 2
+#define STOPPED 3
 #define BACKGROUND_TASK_FLAG "&"
 #define AND_OPERATOR "&&"
 #define INPUT_REDIR_OPERATOR "<"
 #define OUTPUT_REDIR_OPERATOR ">"
 #define ERROR_REDIR_OPERATOR "2>"
+#define PIPE_OPERATOR "|"
+// builtin that can stand between two stages of a pipeline
+#define RELAY_COMMAND "relay"
+// bytes the relay moves per splice or tee
+#define RELAY_CHUNK_SIZE (1 << 16)
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+// how programs are started, picked with the MYSHELL_SPAWN environment
+// variable so that the two can be compared
+#define SPAWN_BACKEND_ENV "MYSHELL_SPAWN"
+#define FORK_BACKEND 0
+#define POSIX_SPAWN_BACKEND 1
+#define OUTPUT_FILE_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#define OUTPUT_FILE_MODE (S_IRWXU | S_IRWXG | S_IRWXO)
+// processes handed out by the pool at a time
+#define PROCESS_POOL_CHUNK_SIZE 64
+#define INITIAL_PROCESS_TABLE_SIZE 64
+// exited processes still listed by info, older ones are forgotten
+#define EXITED_HISTORY_SIZE MAX_PROCESSES
+// room for this many unread exits in the pipe of the SIGCHLD handler
+#define CHILD_EVENT_PIPE_SIZE (1 << 20)
 
-typedef struct
+typedef struct PROCESS
 {
     pid_t pid;
     int state_id;
     int status;
+    // neighbours in the order the processes were started, as listed by info
+    struct PROCESS *prev;
+    struct PROCESS *next;
+    // 1 while the shell waits on the process, which then stays in the
+    // exited history even if it is the oldest there
+    int is_pinned;
+    // the job this process is a stage of, which is the process of the first
+    // stage. Only jobs are listed by info, the other stages are forgotten as
+    // soon as they exit.
+    struct PROCESS *job;
+    // RUNNING, STOPPED or EXITED for this process alone, while state_id is
+    // that of its job
+    int stage_state_id;
+    // the stage after this one in the pipeline
+    struct PROCESS *next_stage;
+    // the rest is only kept for jobs
+    int num_stages;
+    int num_running_stages;
+    int num_stopped_stages;
+    // signal that stopped the last stage to stop
+    int stop_signal;
+    // 1 if the stages are in a process group of their own, led by the
+    // first stage
+    int has_own_group;
+    // the last stage, whose exit status is that of the job
+    pid_t last_pid;
 } process;
 
-static const char *PROCESS_STATE[] = {"Running", "Exited", "Terminating"};
+// One program of a command, stages of a pipeline are joined by pipes
+typedef struct
+{
+    char *program;
+    char **args;
+    char *input_file;
+    char *output_file;
+    char *error_file;
+    // pipe ends that become stdin and stdout, -1 if not piped
+    int in_fd;
+    int out_fd;
+    // read end of the pipe after this stage, which the stage must not keep
+    int next_in_fd;
+} stage;
+
+// An exit reaped, or a stop or continue seen, by the SIGCHLD handler, as
+// reported by waitid
+typedef struct
+{
+    pid_t pid;
+    int code;
+    int value;
+} child_event;
+
+typedef struct PROCESS_CHUNK
+{
+    struct PROCESS_CHUNK *next;
+    process processes[PROCESS_POOL_CHUNK_SIZE];
+} process_chunk;
+
+static const char *PROCESS_STATE[] = {"Running", "Exited", "Terminating", "Stopped"};
+static const char *SPAWN_BACKENDS[] = {"fork", "posix_spawn", NULL};
 static const char *SHELL_COMMANDS[] = {"info", "wait", "terminate", NULL};
 
-static int num_child_processes;
-// history of all the child processes the shell has executed
-static process *child_processes[MAX_PROCESSES];
+// child processes the shell has executed, oldest first
+static process *first_process;
+static process *last_process;
+// open addressing table from pid to process (linear probing), always a
+// power of 2 in size and at most half full
+static process **process_table;
+static int process_table_size;
+static int num_tracked_processes;
+// ring of the exited processes in the order they exited. Once it is full
+// the oldest is dropped so that memory stays bounded however many
+// programs are run.
+static process *exited_processes[EXITED_HISTORY_SIZE];
+static int first_exited;
+static int num_exited;
+// processes are allocated in chunks and recycled through free_processes
+static process_chunk *process_chunks;
+static process *free_processes;
+// the SIGCHLD handler reaps children as they exit and writes their exits
+// here, the shell applies them to the processes in drain_child_events
+static int child_event_pipe[2];
+// FORK_BACKEND or POSIX_SPAWN_BACKEND
+static int spawn_backend;
 
 /* helper function prototypes */
 // returns id corresponding to given shell commands, -1 is returned for user program command
@@ -49,14 +148,45 @@ static int get_shell_command_id(char *command);
 // returns 1 if should run program in background else 0
 static int check_should_run_in_background(char **args, size_t *num_args);
 static void check_redirection_files(char **args, size_t *num_args, char **input_file, char **output_file, char **error_file);
+static process *allocate_process();
+static void free_process(process *child_process);
+// starts tracking a new child process as a job of its own and returns it
+static process *add_child_process(pid_t pid);
+// starts tracking pid as another stage of job
+static void add_pipeline_stage(process *job, pid_t pid);
+// stops tracking the process and returns it to the pool
+static void remove_child_process(process *child_process);
+static void remove_from_table(pid_t pid);
 static process *get_child_process(pid_t pid);
-static void refresh_process_state(process *child_process, int options);
+// returns the job pid is a stage of, or NULL if it is not tracked
+static process *get_job(pid_t pid);
+// sends signum to every stage of the job that is still running
+static int signal_job(process *job, int signum);
+// moves the process to EXITED and into the history of exited processes
+static void mark_exited(process *child_process);
+static void handle_sigchld(int signum);
+// applies the exits reaped since the last call, with SIGCHLD blocked so
+// that the handler does not run in between
+static void drain_child_events();
+// blocks until the process has exited or stopped and returns its status
+static int wait_for_process(process *child_process);
 static void exec_info();
 static void exec_wait(pid_t pid);
 static void exec_terminate(pid_t pid);
-// returns the exit status of the executed program
-// 0 is returned if the executed program runs in background
-static int exec_program(char *program, char **args, int should_run_in_background, char *input_file, char *output_file, char *error_file);
+// copies stdin to stdout (and the file in args, if any) with splice and tee
+static int run_relay(char **args);
+// starts the program of the stage with its standard streams connected to
+// its pipes and redirected to its files (if any) and returns its pid, or -1
+// if it could not be started. The program is put in process group pgid (a
+// new one if 0) unless pgid is -1.
+static pid_t fork_program(stage *program_stage, pid_t pgid, const sigset_t *child_mask);
+static pid_t spawn_program(stage *program_stage, pid_t pgid, const sigset_t *child_mask);
+// returns the exit status of the last stage
+// 0 is returned if the executed programs run in background
+static int exec_program(stage *stages, size_t num_stages, int should_run_in_background);
+// splits args into the stages of a pipeline, returns 0 if all of them can
+// be run else -1
+static int parse_stages(char **args, size_t num_args, stage *stages, size_t num_stages);
 // returns 0 if the command is executed without errors else -1
 static int exec_command(char **args, size_t num_args, int is_chaining_commands);
 
@@ -72,7 +202,55 @@ static int check_syscall(int value, const char *error_msg)
 void my_init(void)
 {
     // Initialize what you need here
-    num_child_processes = 0;
+    first_process = NULL;
+    last_process = NULL;
+    process_table_size = INITIAL_PROCESS_TABLE_SIZE;
+    process_table = (process **)calloc(process_table_size, sizeof(process *));
+    num_tracked_processes = 0;
+    first_exited = 0;
+    num_exited = 0;
+    process_chunks = NULL;
+    free_processes = NULL;
+
+    // the handler never blocks on a full pipe, it leaves the child to be
+    // reaped by drain_child_events instead
+    check_syscall(pipe2(child_event_pipe, O_CLOEXEC | O_NONBLOCK), "my_init: pipe2 error");
+    fcntl(child_event_pipe[1], F_SETPIPE_SZ, CHILD_EVENT_PIPE_SIZE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_sigchld;
+    sigemptyset(&(action.sa_mask));
+    // restart the read of the next command rather than failing it. Stops
+    // are reported too, so that a wait on a stopped job can end.
+    action.sa_flags = SA_RESTART;
+    check_syscall(sigaction(SIGCHLD, &action, NULL), "my_init: sigaction error");
+
+    // SIGCHLD may have been blocked by whoever started the shell
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
+    spawn_backend = FORK_BACKEND;
+    char *backend = getenv(SPAWN_BACKEND_ENV);
+    if (backend)
+    {
+        int i = 0;
+        while (SPAWN_BACKENDS[i] && strcmp(backend, SPAWN_BACKENDS[i]) != 0)
+        {
+            i++;
+        }
+
+        if (SPAWN_BACKENDS[i])
+        {
+            spawn_backend = i;
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown backend %s, using fork\n", SPAWN_BACKEND_ENV, backend);
+        }
+    }
 }
 
 void my_process_command(size_t num_tokens, char **tokens)
@@ -105,19 +283,29 @@ void my_quit(void)
 {
     // Clean up function, called after "quit" is entered as a user command
 
-    process *child_process;
-    while (num_child_processes)
+    for (process *child_process = last_process; child_process; child_process = child_process->prev)
     {
-        child_process = child_processes[--num_child_processes];
-
         if (child_process->state_id != EXITED)
         {
-            check_syscall(kill(child_process->pid, SIGTERM), "my_quit: kill SIGTERM error");
-            refresh_process_state(child_process, 0);
+            check_syscall(signal_job(child_process, SIGTERM), "my_quit: kill SIGTERM error");
+            if (child_process->num_stopped_stages > 0)
+            {
+                check_syscall(signal_job(child_process, SIGCONT), "my_quit: kill SIGCONT error");
+            }
+            child_process->state_id = TERMINATING;
+            wait_for_process(child_process);
         }
+    }
 
-        free(child_process);
+    while (process_chunks)
+    {
+        process_chunk *chunk = process_chunks;
+        process_chunks = chunk->next;
+        free(chunk);
     }
+    free(process_table);
+    close(child_event_pipe[0]);
+    close(child_event_pipe[1]);
     printf("Goodbye!\n");
 }
 
@@ -176,41 +364,437 @@ static void check_redirection_files(char **args, size_t *num_args, char **input_
     }
 }
 
+static process *allocate_process()
+{
+    if (!free_processes)
+    {
+        process_chunk *chunk = (process_chunk *)malloc(sizeof(process_chunk));
+        chunk->next = process_chunks;
+        process_chunks = chunk;
+
+        for (int i = 0; i < PROCESS_POOL_CHUNK_SIZE; i++)
+        {
+            free_process(&(chunk->processes[i]));
+        }
+    }
+
+    process *child_process = free_processes;
+    free_processes = child_process->next;
+    return child_process;
+}
+
+static void free_process(process *child_process)
+{
+    child_process->next = free_processes;
+    free_processes = child_process;
+}
+
+static int hash_pid(pid_t pid)
+{
+    // Fibonacci hashing: the top bits of the product depend on every bit
+    // of the pid, so consecutive pids are spread over the table
+    int table_bits = __builtin_ctz(process_table_size);
+    return (int)(((unsigned int)pid * 2654435769u) >> (32 - table_bits));
+}
+
+// Returns the slot of pid, or the empty slot where it would go
+static int find_slot(pid_t pid)
+{
+    int slot = hash_pid(pid);
+
+    while (process_table[slot] && process_table[slot]->pid != pid)
+    {
+        slot = (slot + 1) & (process_table_size - 1);
+    }
+    return slot;
+}
+
+static void grow_process_table()
+{
+    process **old_table = process_table;
+    int old_size = process_table_size;
+
+    process_table_size *= 2;
+    process_table = (process **)calloc(process_table_size, sizeof(process *));
+
+    for (int i = 0; i < old_size; i++)
+    {
+        if (old_table[i])
+        {
+            process_table[find_slot(old_table[i]->pid)] = old_table[i];
+        }
+    }
+    free(old_table);
+}
+
+// Allocates a running process for pid and puts it in the table
+static process *track_process(pid_t pid, process *job)
+{
+    if (2 * (num_tracked_processes + 1) > process_table_size)
+    {
+        grow_process_table();
+    }
+
+    process *new_process = allocate_process();
+    new_process->pid = pid;
+    new_process->state_id = RUNNING;
+    new_process->status = 0;
+    new_process->job = job ? job : new_process;
+    new_process->is_pinned = 0;
+    new_process->stage_state_id = RUNNING;
+    new_process->next_stage = NULL;
+
+    // a pid can only be reused once its old process was reaped. The old
+    // one stays listed by info until it leaves the exited history, but
+    // lookups now find the new one.
+    if (get_child_process(pid))
+    {
+        remove_from_table(pid);
+    }
+
+    process_table[find_slot(pid)] = new_process;
+    num_tracked_processes++;
+    return new_process;
+}
+
+static process *add_child_process(pid_t pid)
+{
+    process *new_process = track_process(pid, NULL);
+    new_process->num_stages = 1;
+    new_process->num_running_stages = 1;
+    new_process->num_stopped_stages = 0;
+    new_process->stop_signal = 0;
+    new_process->has_own_group = 0;
+    new_process->last_pid = pid;
+
+    new_process->prev = last_process;
+    new_process->next = NULL;
+    if (last_process)
+    {
+        last_process->next = new_process;
+    }
+    else
+    {
+        first_process = new_process;
+    }
+    last_process = new_process;
+
+    return new_process;
+}
+
+static void add_pipeline_stage(process *job, pid_t pid)
+{
+    process *last_stage = job;
+    while (last_stage->next_stage)
+    {
+        last_stage = last_stage->next_stage;
+    }
+    last_stage->next_stage = track_process(pid, job);
+
+    job->num_stages++;
+    job->num_running_stages++;
+    job->last_pid = pid;
+}
+
+// Removes pid from the table by backward shift deletion: later entries of
+// the probe sequence move into the gap so that no tombstones are needed
+static void remove_from_table(pid_t pid)
+{
+    int gap = find_slot(pid);
+    int slot = gap;
+    process_table[gap] = NULL;
+
+    while (process_table[slot = (slot + 1) & (process_table_size - 1)])
+    {
+        int home = hash_pid(process_table[slot]->pid);
+        // the entry may move into the gap unless its home lies in (gap, slot]
+        if (((slot - home) & (process_table_size - 1)) >= ((slot - gap) & (process_table_size - 1)))
+        {
+            process_table[gap] = process_table[slot];
+            process_table[slot] = NULL;
+            gap = slot;
+        }
+    }
+    num_tracked_processes--;
+}
+
+// Stops tracking the process in the table and returns it to the pool
+static void untrack_process(process *child_process)
+{
+    // the pid may belong to a newer process by now
+    if (get_child_process(child_process->pid) == child_process)
+    {
+        remove_from_table(child_process->pid);
+    }
+    free_process(child_process);
+}
+
+static void remove_child_process(process *child_process)
+{
+    if (child_process->prev)
+    {
+        child_process->prev->next = child_process->next;
+    }
+    else
+    {
+        first_process = child_process->next;
+    }
+    if (child_process->next)
+    {
+        child_process->next->prev = child_process->prev;
+    }
+    else
+    {
+        last_process = child_process->prev;
+    }
+
+    untrack_process(child_process);
+}
+
 static process *get_child_process(pid_t pid)
 {
-    for (int i = 0; i < num_child_processes; i++)
+    return process_table[find_slot(pid)];
+}
+
+static process *get_job(pid_t pid)
+{
+    process *child_process = get_child_process(pid);
+    return child_process ? child_process->job : NULL;
+}
+
+static int signal_job(process *job, int signum)
+{
+    // the group of the first stage stays valid until all stages have exited
+    if (job->has_own_group)
+    {
+        return killpg(job->pid, signum);
+    }
+
+    // a foreground pipeline shares the group of the shell, so its stages
+    // are signalled one by one. Only the first stays listed after it exits.
+    int result = 0;
+    for (process *stage_process = job; stage_process; stage_process = stage_process->next_stage)
+    {
+        if (stage_process->stage_state_id != EXITED && kill(stage_process->pid, signum) == -1)
+        {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+static void mark_exited(process *child_process)
+{
+    child_process->state_id = EXITED;
+
+    if (num_exited == EXITED_HISTORY_SIZE)
     {
-        if (child_processes[i]->pid == pid)
+        // a single drain can apply more exits than the history holds, so
+        // the process being waited on may have become the oldest. The next
+        // oldest goes in its place.
+        if (exited_processes[first_exited]->is_pinned)
+        {
+            int next_exited = (first_exited + 1) % EXITED_HISTORY_SIZE;
+            process *pinned_process = exited_processes[first_exited];
+            exited_processes[first_exited] = exited_processes[next_exited];
+            exited_processes[next_exited] = pinned_process;
+        }
+
+        // the entry of the oldest exited process is reused for this one
+        remove_child_process(exited_processes[first_exited]);
+        first_exited = (first_exited + 1) % EXITED_HISTORY_SIZE;
+        num_exited--;
+    }
+
+    exited_processes[(first_exited + num_exited) % EXITED_HISTORY_SIZE] = child_process;
+    num_exited++;
+}
+
+static void handle_sigchld(int signum)
+{
+    (void)signum;
+    int saved_errno = errno;
+    siginfo_t info;
+
+    // look at the next exit without reaping it, the child is only reaped
+    // once its exit is in the pipe
+    while (memset(&info, 0, sizeof(info)),
+           waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WCONTINUED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0)
+    {
+        if (info.si_code == CLD_STOPPED || info.si_code == CLD_CONTINUED)
+        {
+            // the pid stays taken, so the change is consumed first. It is
+            // looked at again if it turned into an exit in the meantime.
+            pid_t pid = info.si_pid;
+            memset(&info, 0, sizeof(info));
+            if (waitid(P_PID, pid, &info, WSTOPPED | WCONTINUED | WNOHANG) != 0 || info.si_pid == 0)
+            {
+                continue;
+            }
+        }
+
+        child_event event = {info.si_pid, info.si_code, info.si_status};
+        if (write(child_event_pipe[1], &event, sizeof(event)) != sizeof(event))
         {
-            return child_processes[i];
+            break;
+        }
+        if (event.code != CLD_STOPPED && event.code != CLD_CONTINUED)
+        {
+            waitid(P_PID, event.pid, &info, WEXITED | WNOHANG);
         }
     }
 
-    return NULL;
+    errno = saved_errno;
 }
 
-static void refresh_process_state(process *child_process, int options)
+// Moves a stopped stage back to RUNNING, and its job once no stage of it
+// is stopped
+static void resume_stage(process *stage_process)
 {
-    if (!child_process ||
-        child_process->state_id == EXITED ||
-        check_syscall(waitpid(child_process->pid, &(child_process->status), options), "refresh_process_state: waitpid error") != child_process->pid ||
-        !(WIFEXITED(child_process->status) || WIFSIGNALED(child_process->status)))
+    process *job = stage_process->job;
+    stage_process->stage_state_id = RUNNING;
+
+    if (--job->num_stopped_stages == 0 && job->state_id == STOPPED)
+    {
+        job->state_id = RUNNING;
+    }
+}
+
+// Unlinks a stage other than the first from its job and stops tracking it
+static void remove_stage(process *stage_process)
+{
+    process *previous_stage = stage_process->job;
+    while (previous_stage->next_stage != stage_process)
+    {
+        previous_stage = previous_stage->next_stage;
+    }
+    previous_stage->next_stage = stage_process->next_stage;
+
+    untrack_process(stage_process);
+}
+
+static void apply_child_event(child_event *event)
+{
+    process *child_process = get_child_process(event->pid);
+    if (!child_process || child_process->stage_state_id == EXITED)
     {
         return;
     }
 
-    child_process->state_id = EXITED;
+    process *job = child_process->job;
+    if (event->code == CLD_STOPPED)
+    {
+        if (child_process->stage_state_id == RUNNING)
+        {
+            child_process->stage_state_id = STOPPED;
+            job->num_stopped_stages++;
+            job->stop_signal = event->value;
+            // a job being terminated was continued and is about to exit
+            if (job->state_id == RUNNING)
+            {
+                job->state_id = STOPPED;
+            }
+        }
+        return;
+    }
+    if (event->code == CLD_CONTINUED)
+    {
+        if (child_process->stage_state_id == STOPPED)
+        {
+            resume_stage(child_process);
+        }
+        return;
+    }
+
+    // a stopped stage can still be killed
+    if (child_process->stage_state_id == STOPPED)
+    {
+        resume_stage(child_process);
+    }
+    child_process->stage_state_id = EXITED;
+
+    if (event->pid == job->last_pid)
+    {
+        // same layout as the status of waitpid, so that the W* macros work
+        job->status = event->code == CLD_EXITED
+                          ? (event->value & 0xff) << 8
+                          : (event->value & 0x7f) | (event->code == CLD_DUMPED ? 0x80 : 0);
+    }
+
+    if (child_process != job)
+    {
+        remove_stage(child_process);
+    }
+    if (--job->num_running_stages == 0)
+    {
+        mark_exited(job);
+    }
 }
 
-static void exec_info()
+static void drain_child_events()
+{
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    child_event event;
+    while (read(child_event_pipe[0], &event, sizeof(event)) == sizeof(event))
+    {
+        apply_child_event(&event);
+    }
+
+    // children the handler had no room for, or that exited or stopped
+    // while SIGCHLD was blocked
+    siginfo_t info;
+    while (memset(&info, 0, sizeof(info)),
+           waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WCONTINUED | WNOHANG) == 0 && info.si_pid != 0)
+    {
+        event.pid = info.si_pid;
+        event.code = info.si_code;
+        event.value = info.si_status;
+        apply_child_event(&event);
+    }
+
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+static int wait_for_process(process *child_process)
 {
-    process *child_process;
-    for (int i = 0; i < num_child_processes; i++)
+    struct pollfd event_fd = {child_event_pipe[0], POLLIN, 0};
+
+    child_process->is_pinned = 1;
+    drain_child_events();
+    while (child_process->state_id != EXITED && child_process->state_id != STOPPED)
     {
-        child_process = child_processes[i];
+        // the handler writes to the pipe when a child exits or stops
+        if (poll(&event_fd, 1, -1) == -1 && errno != EINTR)
+        {
+            perror("wait_for_process: poll error");
+            break;
+        }
+        drain_child_events();
+    }
+    child_process->is_pinned = 0;
 
-        refresh_process_state(child_process, WNOHANG);
+    if (child_process->state_id == STOPPED)
+    {
+        // the job would never exit by itself, so it is left stopped
+        printf("[%d] stopped\n", child_process->pid);
+        // same layout as the status of waitpid for a stopped child
+        return (child_process->stop_signal << 8) | 0x7f;
+    }
+    return child_process->state_id == EXITED ? child_process->status : 0;
+}
+
+static void exec_info()
+{
+    // states are kept up to date by the SIGCHLD handler, only the exits it
+    // has reaped since the last command need to be applied
+    drain_child_events();
 
+    for (process *child_process = first_process; child_process; child_process = child_process->next)
+    {
         if (child_process->state_id == EXITED)
         {
             printf("[%d] %s %d\n",
@@ -229,66 +813,338 @@ static void exec_info()
 
 static void exec_wait(pid_t pid)
 {
-    process *child_process = get_child_process(pid);
-    refresh_process_state(child_process, 0);
+    drain_child_events();
+
+    // does not wait on stopped job
+    process *job = get_job(pid);
+    if (job && job->state_id != STOPPED)
+    {
+        wait_for_process(job);
+    }
 }
 
 static void exec_terminate(pid_t pid)
 {
-    process *child_process = get_child_process(pid);
+    // a reaped pid may already belong to someone else
+    drain_child_events();
+
+    process *job = get_job(pid);
 
-    if (!child_process || child_process->state_id == EXITED || check_syscall(kill(pid, SIGTERM), "exec_terminate: kill SIGTERM error") != 0)
+    if (!job ||
+        job->state_id == EXITED ||
+        check_syscall(signal_job(job, SIGTERM), "exec_terminate: kill SIGTERM error") != 0 ||
+        (job->num_stopped_stages > 0 && check_syscall(signal_job(job, SIGCONT), "exec_terminate: kill SIGCONT error") != 0))
     {
         return;
     }
 
-    child_process->state_id = TERMINATING;
+    job->state_id = TERMINATING;
 }
 
-static int exec_program(char *program, char **args, int should_run_in_background, char *input_file, char *output_file, char *error_file)
+static int run_relay(char **args)
 {
-    pid_t pid = check_syscall(fork(), "exec_program: fork error");
+    int tee_fd = -1;
+    if (args[1])
+    {
+        tee_fd = check_syscall(open(args[1], OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE), "relay: open error");
+        if (tee_fd == -1)
+        {
+            return 1;
+        }
+    }
+
+    // the data is moved between the pipe buffers by the kernel. tee only
+    // copies it to stdout, so it is then spliced out of stdin to the file.
+    long long num_relayed = 0;
+    ssize_t num_moved;
+    while ((num_moved = tee_fd == -1
+                            ? splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL, RELAY_CHUNK_SIZE, SPLICE_F_MOVE)
+                            : tee(STDIN_FILENO, STDOUT_FILENO, RELAY_CHUNK_SIZE, 0)) > 0)
+    {
+        for (ssize_t num_left = num_moved; tee_fd != -1 && num_left > 0;)
+        {
+            ssize_t num_written = splice(STDIN_FILENO, NULL, tee_fd, NULL, num_left, SPLICE_F_MOVE);
+            if (num_written <= 0)
+            {
+                perror("relay: splice error");
+                return 1;
+            }
+            num_left -= num_written;
+        }
+        num_relayed += num_moved;
+    }
+
+    if (num_moved == -1)
+    {
+        perror("relay: splice error");
+    }
+    fprintf(stderr, "relay: %lld bytes\n", num_relayed);
+    return num_moved == -1;
+}
+
+static pid_t fork_program(stage *program_stage, pid_t pgid, const sigset_t *child_mask)
+{
+    pid_t pid = check_syscall(fork(), "fork_program: fork error");
 
     if (pid == 0)
     {
-        if (input_file)
+        sigprocmask(SIG_SETMASK, child_mask, NULL);
+        if (pgid != -1)
+        {
+            setpgid(0, pgid);
+        }
+
+        // files given to a stage take the place of its pipes
+        if (program_stage->in_fd != -1)
+        {
+            check_syscall(dup2(program_stage->in_fd, STDIN_FILENO), "fork_program: dup2 in_fd error");
+            check_syscall(close(program_stage->in_fd), "fork_program: close error");
+        }
+        if (program_stage->out_fd != -1)
+        {
+            check_syscall(dup2(program_stage->out_fd, STDOUT_FILENO), "fork_program: dup2 out_fd error");
+            check_syscall(close(program_stage->out_fd), "fork_program: close error");
+            check_syscall(close(program_stage->next_in_fd), "fork_program: close error");
+        }
+        if (program_stage->input_file)
         {
-            int in_fd = check_syscall(open(input_file, O_RDONLY), "exec_program: open input_file error");
-            check_syscall(dup2(in_fd, STDIN_FILENO), "exec_program: dup2 in_fd error");
-            check_syscall(close(in_fd), "exec_program: close error");
+            int in_fd = check_syscall(open(program_stage->input_file, O_RDONLY), "fork_program: open input_file error");
+            check_syscall(dup2(in_fd, STDIN_FILENO), "fork_program: dup2 in_fd error");
+            check_syscall(close(in_fd), "fork_program: close error");
         }
-        if (output_file)
+        if (program_stage->output_file)
         {
-            int out_fd = check_syscall(open(output_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO), "exec_program: open output_file error");
-            check_syscall(dup2(out_fd, STDOUT_FILENO), "exec_program: dup2 out_fd error");
-            check_syscall(close(out_fd), "exec_program: close error");
+            int out_fd = check_syscall(open(program_stage->output_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE), "fork_program: open output_file error");
+            check_syscall(dup2(out_fd, STDOUT_FILENO), "fork_program: dup2 out_fd error");
+            check_syscall(close(out_fd), "fork_program: close error");
         }
-        if (error_file)
+        if (program_stage->error_file)
         {
-            int err_fd = check_syscall(open(error_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO), "exec_program: open error_file error");
-            check_syscall(dup2(err_fd, STDERR_FILENO), "exec_program: dup2 err_fd error");
-            check_syscall(close(err_fd), "exec_program: close error");
+            int err_fd = check_syscall(open(program_stage->error_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE), "fork_program: open error_file error");
+            check_syscall(dup2(err_fd, STDERR_FILENO), "fork_program: dup2 err_fd error");
+            check_syscall(close(err_fd), "fork_program: close error");
         }
 
-        check_syscall(execv(program, args), "exec_program: execv error");
+        if (strcmp(program_stage->program, RELAY_COMMAND) == 0)
+        {
+            // _exit so that the stdio buffers of the shell are not flushed
+            // a second time
+            _exit(run_relay(program_stage->args));
+        }
+
+        check_syscall(execv(program_stage->program, program_stage->args), "fork_program: execv error");
+    }
+    else if (pid > 0 && pgid != -1)
+    {
+        // also done here so that the group exists before the next stage
+        // joins it, whichever of the two runs first
+        setpgid(pid, pgid);
     }
+    return pid;
+}
 
-    process *new_process = (process *)malloc(sizeof(process));
-    new_process->pid = pid;
-    new_process->state_id = RUNNING;
+// Like fork_program, with the redirections done as file actions so that
+// the C library can start the child without copying the page tables of
+// the shell (clone with CLONE_VM | CLONE_VFORK on Linux)
+static pid_t spawn_program(stage *program_stage, pid_t pgid, const sigset_t *child_mask)
+{
+    posix_spawn_file_actions_t file_actions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawnattr_init(&attributes);
+
+    // the pipes themselves are closed on exec
+    if (program_stage->in_fd != -1)
+    {
+        posix_spawn_file_actions_adddup2(&file_actions, program_stage->in_fd, STDIN_FILENO);
+    }
+    if (program_stage->out_fd != -1)
+    {
+        posix_spawn_file_actions_adddup2(&file_actions, program_stage->out_fd, STDOUT_FILENO);
+    }
+    if (program_stage->input_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, program_stage->input_file, O_RDONLY, 0);
+    }
+    if (program_stage->output_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, program_stage->output_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE);
+    }
+    if (program_stage->error_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, program_stage->error_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE);
+    }
+
+    short flags = 0;
+    // SIGCHLD is blocked in the shell while the child is started
+    flags |= POSIX_SPAWN_SETSIGMASK;
+    posix_spawnattr_setsigmask(&attributes, child_mask);
+    if (pgid != -1)
+    {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attributes, pgid);
+    }
+    posix_spawnattr_setflags(&attributes, flags);
+
+    extern char **environ;
+    pid_t pid;
+    int error = posix_spawn(&pid, program_stage->program, &file_actions, &attributes, program_stage->args, environ);
+    if (error)
+    {
+        fprintf(stderr, "spawn_program: posix_spawn error: %s\n", strerror(error));
+        pid = -1;
+    }
+
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attributes);
+    return pid;
+}
+
+static int exec_program(stage *stages, size_t num_stages, int should_run_in_background)
+{
+    // exits reaped before SIGCHLD is blocked are applied now, and none are
+    // reaped until the children are tracked, so that the pid of an exit
+    // still in the pipe cannot have been given to a new child
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+    drain_child_events();
+
+    process *job = NULL;
+    int in_fd = -1;
+    int has_failed = 0;
+
+    for (size_t i = 0; i < num_stages && !has_failed; i++)
+    {
+        int pipe_fds[2] = {-1, -1};
+        if (i + 1 < num_stages && check_syscall(pipe2(pipe_fds, O_CLOEXEC), "exec_program: pipe2 error") == -1)
+        {
+            has_failed = 1;
+            break;
+        }
 
-    child_processes[num_child_processes++] = new_process;
+        stages[i].in_fd = in_fd;
+        stages[i].out_fd = pipe_fds[1];
+        stages[i].next_in_fd = pipe_fds[0];
+
+        // a single program stays in the process group of the shell, and so
+        // does a pipeline in the foreground, which can then read from the
+        // terminal and gets its signals. The stages of a pipeline in the
+        // background get a group of their own led by the first stage.
+        pid_t pgid = num_stages == 1 || !should_run_in_background ? -1 : job ? job->pid : 0;
+        // the relay is a builtin, so it can only be forked
+        pid_t pid = spawn_backend == POSIX_SPAWN_BACKEND && strcmp(stages[i].program, RELAY_COMMAND) != 0
+                        ? spawn_program(&stages[i], pgid, &old_mask)
+                        : fork_program(&stages[i], pgid, &old_mask);
+
+        // the ends given to the stage are only needed by the stage
+        if (in_fd != -1)
+        {
+            close(in_fd);
+        }
+        if (pipe_fds[1] != -1)
+        {
+            close(pipe_fds[1]);
+        }
+        in_fd = pipe_fds[0];
+
+        if (pid == -1)
+        {
+            has_failed = 1;
+        }
+        else if (job)
+        {
+            add_pipeline_stage(job, pid);
+        }
+        else
+        {
+            job = add_child_process(pid);
+            job->has_own_group = pgid != -1;
+        }
+    }
+
+    // without a next stage the stages before see a closed pipe and exit
+    if (in_fd != -1)
+    {
+        close(in_fd);
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    if (!job)
+    {
+        // nothing was started, so there is no job to track
+        return 1;
+    }
 
+    int status = 0;
     if (should_run_in_background)
     {
-        printf("Child[%d] in background\n", new_process->pid);
+        printf("Child[%d] in background\n", job->pid);
     }
     else
     {
-        refresh_process_state(new_process, 0);
+        // the entry may be reused by a later exit once the wait is over
+        status = wait_for_process(job);
     }
 
-    return new_process->state_id == EXITED ? WEXITSTATUS(new_process->status) : 0;
+    return has_failed ? 1 : WEXITSTATUS(status);
+}
+
+static int parse_stages(char **args, size_t num_args, stage *stages, size_t num_stages)
+{
+    size_t start = 0;
+
+    for (size_t i = 0; i < num_stages; i++)
+    {
+        size_t end = start;
+        while (end < num_args && strcmp(args[end], PIPE_OPERATOR) != 0)
+        {
+            end++;
+        }
+        // the stage ends at the pipe, or at the NULL after the last stage
+        args[end] = NULL;
+
+        size_t num_stage_args = end - start;
+        if (num_stage_args == 0)
+        {
+            printf("%s: Missing command\n", PIPE_OPERATOR);
+            return -1;
+        }
+
+        stage *program_stage = &(stages[i]);
+        program_stage->program = args[start];
+        program_stage->args = args + start;
+
+        if (strcmp(program_stage->program, RELAY_COMMAND) == 0)
+        {
+            if (i == 0 || i + 1 == num_stages)
+            {
+                printf("%s: Must be between two programs\n", RELAY_COMMAND);
+                return -1;
+            }
+        }
+        else if (access(program_stage->program, F_OK) != 0)
+        {
+            printf("%s not found\n", program_stage->program);
+            return -1;
+        }
+
+        program_stage->input_file = NULL;
+        program_stage->output_file = NULL;
+        program_stage->error_file = NULL;
+        check_redirection_files(program_stage->args, &(num_stage_args), &(program_stage->input_file), &(program_stage->output_file), &(program_stage->error_file));
+
+        if (program_stage->input_file && access(program_stage->input_file, F_OK) != 0)
+        {
+            printf("%s does not exist\n", program_stage->input_file);
+            return -1;
+        }
+
+        start = end + 1;
+    }
+
+    return 0;
 }
 
 static int exec_command(char **args, size_t num_args, int is_chaining_commands)
@@ -322,40 +1178,37 @@ static int exec_command(char **args, size_t num_args, int is_chaining_commands)
         exec_terminate(atoi(args[1]));
         break;
     default:
-        if (access(command, F_OK) != 0)
-        {
-            printf("%s not found\n", command);
-            return -1;
-        }
-
+    {
         int should_run_in_background = check_should_run_in_background(args, &(num_args));
 
-        char *input_file = NULL, *output_file = NULL, *error_file = NULL;
-        check_redirection_files(args, &(num_args), &(input_file), &(output_file), &(error_file));
-
-        if (input_file && access(input_file, F_OK) != 0)
+        size_t num_stages = 1;
+        for (size_t i = 0; i < num_args; i++)
         {
-            printf("%s does not exist\n", input_file);
-            return -1;
+            num_stages += strcmp(args[i], PIPE_OPERATOR) == 0;
         }
 
-        if (exec_program(
-                command,
-                args,
-                should_run_in_background,
-                input_file,
-                output_file,
-                error_file) != 0)
+        stage *stages = (stage *)malloc(num_stages * sizeof(stage));
+        int result = parse_stages(args, num_args, stages, num_stages);
+
+        if (result == 0 && exec_program(stages, num_stages, should_run_in_background) != 0)
         {
-            // does not print if only running single command/program
+            // does not print if only running single command/program. The
+            // status of a pipeline is that of its last stage.
             if (is_chaining_commands)
             {
-                printf("%s failed\n", command);
+                printf("%s failed\n", stages[num_stages - 1].program);
             }
 
+            result = -1;
+        }
+
+        free(stages);
+        if (result != 0)
+        {
             return -1;
         }
     }
+    }
 
     return 0;
 }
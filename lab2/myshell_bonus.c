@@ -10,6 +10,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
+#include <spawn.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -30,6 +31,13 @@
 #define OUTPUT_REDIR_OPERATOR ">"
 #define ERROR_REDIR_OPERATOR "2>"
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+// how programs are started, picked with the MYSHELL_SPAWN environment
+// variable so that the two can be compared
+#define SPAWN_BACKEND_ENV "MYSHELL_SPAWN"
+#define FORK_BACKEND 0
+#define POSIX_SPAWN_BACKEND 1
+#define OUTPUT_FILE_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#define OUTPUT_FILE_MODE (S_IRWXU | S_IRWXG | S_IRWXO)
 
 typedef struct
 {
@@ -39,6 +47,7 @@ typedef struct
 } process;
 
 static const char *PROCESS_STATE[] = {"Running", "Exited", "Terminating", "Stopped"};
+static const char *SPAWN_BACKENDS[] = {"fork", "posix_spawn", NULL};
 static const char *SHELL_COMMANDS[] = {"info", "wait", "terminate", "fg", NULL};
 
 static int num_child_processes;
@@ -48,6 +57,8 @@ static process *child_processes[MAX_PROCESSES];
 static pid_t waiting_pid;
 // 0 if no signal was caught else 1
 static int has_caught_signal;
+// FORK_BACKEND or POSIX_SPAWN_BACKEND
+static int spawn_backend;
 
 /* helper function prototypes */
 // returns id corresponding to given shell commands, -1 is returned for user program command
@@ -62,6 +73,10 @@ static void exec_info();
 static void exec_wait(pid_t pid);
 static void exec_terminate(pid_t pid);
 static void exec_fg(pid_t pid);
+// starts program with its standard streams redirected to the given files
+// (if any) and returns its pid, or -1 if it could not be started
+static pid_t fork_program(char *program, char **args, char *input_file, char *output_file, char *error_file);
+static pid_t spawn_program(char *program, char **args, char *input_file, char *output_file, char *error_file);
 // returns the exit status of the executed program
 // 0 is returned if the executed program runs in background
 static int exec_program(char *program, char **args, int should_run_in_background, char *input_file, char *output_file, char *error_file);
@@ -84,6 +99,26 @@ void my_init(void)
     waiting_pid = -1;
     has_caught_signal = 0;
 
+    spawn_backend = FORK_BACKEND;
+    char *backend = getenv(SPAWN_BACKEND_ENV);
+    if (backend)
+    {
+        int i = 0;
+        while (SPAWN_BACKENDS[i] && strcmp(backend, SPAWN_BACKENDS[i]) != 0)
+        {
+            i++;
+        }
+
+        if (SPAWN_BACKENDS[i])
+        {
+            spawn_backend = i;
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown backend %s, using fork\n", SPAWN_BACKEND_ENV, backend);
+        }
+    }
+
     // setup signal intercepters
     signal(SIGTSTP, signal_handler);
     signal(SIGINT, signal_handler);
@@ -342,34 +377,90 @@ static void exec_fg(pid_t pid)
     refresh_process_state(child_process, WUNTRACED);
 }
 
-static int exec_program(char *program, char **args, int should_run_in_background, char *input_file, char *output_file, char *error_file)
+static pid_t fork_program(char *program, char **args, char *input_file, char *output_file, char *error_file)
 {
-    pid_t pid = check_syscall(fork(), "exec_program: fork error");
+    pid_t pid = check_syscall(fork(), "fork_program: fork error");
 
     if (pid == 0)
     {
         if (input_file)
         {
-            int in_fd = check_syscall(open(input_file, O_RDONLY), "exec_program: open input_file error");
-            check_syscall(dup2(in_fd, STDIN_FILENO), "exec_program: dup2 in_fd error");
-            check_syscall(close(in_fd), "exec_program: close error");
+            int in_fd = check_syscall(open(input_file, O_RDONLY), "fork_program: open input_file error");
+            check_syscall(dup2(in_fd, STDIN_FILENO), "fork_program: dup2 in_fd error");
+            check_syscall(close(in_fd), "fork_program: close error");
         }
         if (output_file)
         {
-            int out_fd = check_syscall(open(output_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO), "exec_program: open output_file error");
-            check_syscall(dup2(out_fd, STDOUT_FILENO), "exec_program: dup2 out_fd error");
-            check_syscall(close(out_fd), "exec_program: close error");
+            int out_fd = check_syscall(open(output_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE), "fork_program: open output_file error");
+            check_syscall(dup2(out_fd, STDOUT_FILENO), "fork_program: dup2 out_fd error");
+            check_syscall(close(out_fd), "fork_program: close error");
         }
         if (error_file)
         {
-            int err_fd = check_syscall(open(error_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO), "exec_program: open error_file error");
-            check_syscall(dup2(err_fd, STDERR_FILENO), "exec_program: dup2 err_fd error");
-            check_syscall(close(err_fd), "exec_program: close error");
+            int err_fd = check_syscall(open(error_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE), "fork_program: open error_file error");
+            check_syscall(dup2(err_fd, STDERR_FILENO), "fork_program: dup2 err_fd error");
+            check_syscall(close(err_fd), "fork_program: close error");
         }
 
         setpgid(0, 0);
 
-        check_syscall(execv(program, args), "exec_program: execv error");
+        check_syscall(execv(program, args), "fork_program: execv error");
+    }
+    return pid;
+}
+
+// Like fork_program, with the redirections done as file actions so that
+// the C library can start the child without copying the page tables of
+// the shell (clone with CLONE_VM | CLONE_VFORK on Linux)
+static pid_t spawn_program(char *program, char **args, char *input_file, char *output_file, char *error_file)
+{
+    posix_spawn_file_actions_t file_actions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawnattr_init(&attributes);
+
+    if (input_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, input_file, O_RDONLY, 0);
+    }
+    if (output_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, output_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE);
+    }
+    if (error_file)
+    {
+        posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, error_file, OUTPUT_FILE_FLAGS, OUTPUT_FILE_MODE);
+    }
+
+    short flags = 0;
+    // own process group, like setpgid(0, 0) in the child
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, flags);
+
+    extern char **environ;
+    pid_t pid;
+    int error = posix_spawn(&pid, program, &file_actions, &attributes, args, environ);
+    if (error)
+    {
+        fprintf(stderr, "spawn_program: posix_spawn error: %s\n", strerror(error));
+        pid = -1;
+    }
+
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attributes);
+    return pid;
+}
+
+static int exec_program(char *program, char **args, int should_run_in_background, char *input_file, char *output_file, char *error_file)
+{
+    pid_t pid = spawn_backend == POSIX_SPAWN_BACKEND
+                    ? spawn_program(program, args, input_file, output_file, error_file)
+                    : fork_program(program, args, input_file, output_file, error_file);
+    if (pid == -1)
+    {
+        // nothing was started, so there is no job to track
+        return 1;
     }
 
     process *new_process = (process *)malloc(sizeof(process));